@@ -27,7 +27,9 @@
 
 /**************************************************************************
  * Block device (disk) activity indication for the Raspberry Pi, using one
- *  or two LEDs connected to one or two GPIO pins.
+ *  or two LEDs connected to one or two GPIO pins. Further LEDs can be
+ *  driven from any other /proc/vmstat counter (swap traffic, page cache
+ *  refaults, OOM kills, ...) with the -m option.
  * 
  * GPIO pin ----|>|----[330]----+
  *              LED             |
@@ -41,7 +43,8 @@
  *
  *
  * To compile:
- *   gcc PiDiskLeds.c -std=gnu11 -Wall -O3 -o PiDiskLeds -lwiringPi
+ *   make PiDiskLeds
+ *  (vmstatkeytable.h is generated from vmstatkeys.txt by mkvmstatkeytable)
  *
  * 
  * NOTE: The default LED pin for both receive and transmit activity is
@@ -57,6 +60,12 @@
 #define _GNU_SOURCE
 
 #include <argp.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <poll.h>
+#include <limits.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -64,10 +73,22 @@
 #include <time.h>
 #include <unistd.h>
 #include <stdbool.h>
-
-#include <wiringPi.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
 
 #include "macroasstring.h"
+#include "gpio.h"
+#include "leds.h"
+#include "ratehistogram.h"
+#include "shiftregister.h"
+#include "uevent.h"
+#include "vmstathash.h"
+#include "vmstatkeytable.h"
 #include "pidiskleds.h"
 #include "pidiskledsstrings.h"
 
@@ -82,106 +103,1153 @@ static unsigned int  Option_Poll_Interval_Time = DEFAULT_POLL_TIME_MILLISECONDS;
 static unsigned int  Option_Wr_Led_GPIO_Pin    = DEFAULT_WR_LED_GPIO_PIN;        /* wiringPi numbering scheme */
 static unsigned int  Option_Rd_Led_GPIO_Pin    = DEFAULT_RD_LED_GPIO_PIN;        /* wiringPi numbering scheme */
 static bool          Option_Detach             = false;
+static const char*   Option_Waveform_File_Name = NULL;                           /* Simulate the GPIO pins, recording to this file */
+static const char*   Option_Stats_File_Name    = VM_STATS_FILE_NAME;
+static const char*   Option_Uevent_Socket_Path = NULL;                           /* NULL: hot-plug events from the kernel */
+static bool          Option_Use_Bar_Graph      = false;
+static struct bar_graph Option_Bar_Graph;
+static const char*   Option_Rate_Report_File_Name = NULL;                        /* NULL: no rate histograms */
+static unsigned int  Option_Rate_Report_Interval  = RATE_REPORT_DEFAULT_INTERVAL_SECONDS;
+static struct rate_report Rate_Report;
 
 static volatile bool Keep_Running              = true;
 
 
-/* Reread the vmstat file */
-int Activity( FILE* fp_vm_stats_file, bool* p_wrAct, bool* p_rdAct )
+typedef enum
 {
-    static unsigned int prev_pgpgin                    = 0;
-    static unsigned int prev_pgpgout                   = 0;
+    RULE_CHANGED,                          /* LED on when the counter moved since the last poll */
+    RULE_RATE_ABOVE,                       /* LED on when the counter rose faster than the limit */
+    RULE_BRIGHTNESS                        /* LED brightness follows the rate, full at the limit */
+} counter_rule_t;
 
-    unsigned int        cur_pgpgin                     = 0;
-    unsigned int        cur_pgpgout                    = 0;
-    char*               vm_stats_file_line_buffer      = NULL; // Let getline() worry about the line length
-    bool                found_pgpgin                   = false;
-    bool                found_pgpgout                  = false;
-    size_t              vm_stats_file_line_buffer_size = 0;
+struct vm_counter
+{
+    char               name[MAX_COUNTER_NAME_LENGTH + 1];
+    size_t             name_length;
+    int                known_key;          /* Index into Vm_Stat_Known_Keys, or -1 for the slow path */
+    bool               found;
+    size_t             line_offset;        /* Where the counter's line started in the last read */
+    unsigned long long value;
+    unsigned long long previous_value;
+    unsigned long long delta;              /* Change over the last poll interval */
+};
 
-    int                 result;
+struct counter_mapping
+{
+    unsigned int       counter;            /* Index into Counters */
+    counter_rule_t     rule;
+    unsigned long long limit;              /* Counts per second, for the rate rules */
+    unsigned int       pin;
+};
 
-    /* Reload the vmstat file */
-    result = TEMP_FAILURE_RETRY( fseek(fp_vm_stats_file, 0L, SEEK_SET) );
-    if( result != 0 )
-    {
-            perror( VM_STATS_FILE_SEEK_ERROR_MSG );
-            return result;
-    }
+static struct vm_counter      Counters[MAX_COUNTER_MAPPINGS + 2];
+static unsigned int           Counter_Count             = 0;
+static unsigned int           Unknown_Counter_Count     = 0;
+static unsigned char          Counter_For_Known_Key[VM_STAT_KNOWN_KEY_COUNT]; /* Counter index + 1, 0 if not wanted */
+
+static struct counter_mapping Mappings[MAX_COUNTER_MAPPINGS + 2];
+static unsigned int           Mapping_Count             = 0;
+static unsigned int           Option_Map_Count          = 0;
+
+static char                   Vm_Stats_Buffer[VM_STATS_BUFFER_SIZE];
+static size_t                 Vm_Stats_Read_Length      = VM_STATS_BUFFER_SIZE;
+static bool                   Vm_Stats_Offsets_Valid    = false;
+
+
+/* Perfect-hash lookup of a vmstat key; -1 if it is not one of the keys known at build time */
+static int VmStatKnownKey( uint32_t hash, const char* key, size_t key_length )
+{
+    uint32_t slot      = VmStatHashSlot( hash, Vm_Stat_Hash_Displacements[hash & VM_STAT_HASH_BUCKET_MASK], VM_STAT_HASH_SLOT_MASK );
+    int      known_key = Vm_Stat_Hash_Slot_Keys[slot];
+
+    if( (known_key >= 0) && (Vm_Stat_Known_Key_Lengths[known_key] == key_length) && (memcmp(Vm_Stat_Known_Keys[known_key], key, key_length) == 0) )
+        return known_key;
+
+    return -1;
+}
+
+
+/* Find or add the counter with this name */
+static int AddCounter( const char* name, size_t name_length )
+{
+    struct vm_counter* counter;
 
-    /* Clear glibc's buffer */
-    result = TEMP_FAILURE_RETRY( fflush(fp_vm_stats_file) );
-    if( result != 0 )
+    for( unsigned int index = 0; index < Counter_Count; index++ )
     {
-            perror( FILE_BUFFER_FLUSH_ERROR_MSG );
-            return result;
+        if( (Counters[index].name_length == name_length) && (memcmp(Counters[index].name, name, name_length) == 0) )
+            return index;
     }
 
-    /* Extract the I/O stats */
-    while( (getline(&vm_stats_file_line_buffer, &vm_stats_file_line_buffer_size, fp_vm_stats_file) != -1) && (errno != EINTR) )
+    if( (Counter_Count == (sizeof(Counters) / sizeof(Counters[0]))) || (name_length == 0) || (name_length > MAX_COUNTER_NAME_LENGTH) )
+        return -1;
+
+    counter = &Counters[Counter_Count];
+    memcpy( counter->name, name, name_length );
+    counter->name[name_length] = '\0';
+    counter->name_length       = name_length;
+    counter->known_key         = VmStatKnownKey( VmStatHash(name, name_length), name, name_length );
+
+    if( counter->known_key >= 0 )
+        Counter_For_Known_Key[counter->known_key] = Counter_Count + 1;
+    else
+        Unknown_Counter_Count++;
+
+    return Counter_Count++;
+}
+
+
+static bool AddMapping( const char* name, size_t name_length, counter_rule_t rule, unsigned long long limit, unsigned int pin )
+{
+    int counter = AddCounter( name, name_length );
+
+    if( (counter < 0) || (Mapping_Count == (sizeof(Mappings) / sizeof(Mappings[0]))) )
+        return false;
+
+    Mappings[Mapping_Count].counter = counter;
+    Mappings[Mapping_Count].rule    = rule;
+    Mappings[Mapping_Count].limit   = limit;
+    Mappings[Mapping_Count].pin     = pin;
+    Mapping_Count++;
+
+    return true;
+}
+
+
+/* Parse the decimal value at the end of a vmstat line; NULL if the line is not complete */
+static const char* ParseCounterValue( const char* text, const char* text_end, unsigned long long* p_value )
+{
+    unsigned long long value = 0;
+
+    while( (text < text_end) && (*text == ' ') )
+        text++;
+
+    while( (text < text_end) && (*text >= '0') && (*text <= '9') )
+        value = (value * 10) + (*text++ - '0');
+
+    if( (text == text_end) || (*text != '\n') )
+        return NULL;
+
+    *p_value = value;
+
+    return text + 1;
+}
+
+
+/* Full pass: look up the key of every line and remember where the wanted lines are */
+static void ScanVmStats( const char* text, size_t length )
+{
+    const char* text_end    = text + length;
+    const char* line        = text;
+    size_t      wanted_end  = 0;
+
+    for( unsigned int index = 0; index < Counter_Count; index++ )
+        Counters[index].found = false;
+
+    while( line < text_end )
     {
-        if( sscanf(vm_stats_file_line_buffer, "pgpgin %u", &cur_pgpgin) != 0 )
-        {
-            found_pgpgin = true;
+        const char*        key      = line;
+        uint32_t           hash     = VM_STAT_HASH_OFFSET_BASIS;
+        int                counter  = -1;
+        int                known_key;
+        unsigned long long value;
 
-            if( (*p_wrAct = (cur_pgpgin != prev_pgpgin)) == true )
+        while( (line < text_end) && (*line != ' ') && (*line != '\n') )
+            hash = VmStatHashStep( hash, (unsigned char)*line++ );
+
+        known_key = VmStatKnownKey( hash, key, line - key );
+        if( known_key >= 0 )
+        {
+            counter = (int)Counter_For_Known_Key[known_key] - 1;
+        }
+        else if( Unknown_Counter_Count > 0 )
+        {
+            /* Slow path for keys this kernel has but the build did not know about */
+            for( unsigned int index = 0; index < Counter_Count; index++ )
             {
-                prev_pgpgin = cur_pgpgin;
+                if( (Counters[index].known_key < 0) && (Counters[index].name_length == (size_t)(line - key)) && (memcmp(Counters[index].name, key, line - key) == 0) )
+                {
+                    counter = index;
+                    break;
+                }
             }
         }
-        else if( sscanf(vm_stats_file_line_buffer, "pgpgout %u", &cur_pgpgout) !=0 )
+
+        if( counter >= 0 )
         {
-            found_pgpgout = true;
+            const char* next_line = ParseCounterValue( line, text_end, &value );
 
-            if( (*p_rdAct = (cur_pgpgout != prev_pgpgout)) == true )
-            {
-                prev_pgpgout = cur_pgpgout;
-            }
+            if( next_line == NULL )
+                break;
+
+            Counters[counter].value       = value;
+            Counters[counter].line_offset = key - text;
+            Counters[counter].found       = true;
+            wanted_end                    = next_line - text;
+            line                          = next_line;
+        }
+        else
+        {
+            line = memchr( line, '\n', text_end - line );
+            if( line == NULL )
+                break;
+            line++;
+        }
+    }
+
+    /* From now on, only read as far as the last wanted line (plus room for the values to grow) */
+    Vm_Stats_Read_Length   = wanted_end + VM_STATS_READ_SLACK;
+    if( Vm_Stats_Read_Length > sizeof(Vm_Stats_Buffer) )
+        Vm_Stats_Read_Length = sizeof(Vm_Stats_Buffer);
+
+    Vm_Stats_Offsets_Valid = true;
+}
+
+
+/* Fast pass: go straight to the cached line offsets; false if any of the lines has moved */
+static bool ReadCachedVmStats( const char* text, size_t length )
+{
+    for( unsigned int index = 0; index < Counter_Count; index++ )
+    {
+        struct vm_counter* counter = &Counters[index];
+        const char*        key     = text + counter->line_offset;
+
+        if( counter->found == false )
+            continue;
+
+        if( (counter->line_offset + counter->name_length >= length)
+         || ((counter->line_offset > 0) && (key[-1] != '\n'))
+         || (key[counter->name_length] != ' ')
+         || (memcmp(key, counter->name, counter->name_length) != 0)
+         || (ParseCounterValue(key + counter->name_length, text + length, &counter->value) == NULL) )
+            return false;
+    }
+
+    return true;
+}
+
+
+/* Counts per second, given the change in a counter over the elapsed time */
+static unsigned long long RatePerSecond( unsigned long long delta, unsigned long long elapsed_nanoseconds )
+{
+    if( elapsed_nanoseconds == 0 )
+        return 0;
+
+    if( delta > (ULLONG_MAX / NANOSECONDS_PER_SECOND) )
+        return ULLONG_MAX;
+
+    return (delta * NANOSECONDS_PER_SECOND) / elapsed_nanoseconds;
+}
+
+
+/* Reread the vmstat file, and request the LEDs the mapped counters ask for. A zero elapsed time only records the current values */
+int Activity( int vm_stats_fd, unsigned long long elapsed_nanoseconds )
+{
+    ssize_t length;
+
+    if( Vm_Stats_Offsets_Valid == true )
+    {
+        length = TEMP_FAILURE_RETRY( pread(vm_stats_fd, Vm_Stats_Buffer, Vm_Stats_Read_Length, 0) );
+        if( length < 0 )
+        {
+            perror( VM_STATS_FILE_READ_ERROR_MSG );
+            return -1;
         }
 
-        if( (found_pgpgin == true) && (found_pgpgout == true) )
+        Vm_Stats_Offsets_Valid = ReadCachedVmStats( Vm_Stats_Buffer, length );
+    }
+
+    /* First pass, or a line moved because an earlier value gained a digit */
+    if( Vm_Stats_Offsets_Valid == false )
+    {
+        length = TEMP_FAILURE_RETRY( pread(vm_stats_fd, Vm_Stats_Buffer, sizeof(Vm_Stats_Buffer), 0) );
+        if( length < 0 )
+        {
+            perror( VM_STATS_FILE_READ_ERROR_MSG );
+            return -1;
+        }
+
+        ScanVmStats( Vm_Stats_Buffer, length );
+    }
+
+    for( unsigned int index = 0; index < Counter_Count; index++ )
+    {
+        Counters[index].delta          = (elapsed_nanoseconds > 0) ? (Counters[index].value - Counters[index].previous_value) : 0;
+        Counters[index].previous_value = Counters[index].value;
+    }
+
+    for( unsigned int index = 0; index < Mapping_Count; index++ )
+    {
+        struct counter_mapping* mapping = &Mappings[index];
+        struct vm_counter*      counter = &Counters[mapping->counter];
+        unsigned long long      delta   = counter->delta;
+        unsigned long long      rate;
+
+        if( (counter->found == false) || (delta == 0) )
+            continue;
+
+        switch( mapping->rule )
         {
+            case RULE_CHANGED:
+                LedsRequest( mapping->pin, LED_LEVEL_FULL );
+                break;
+
+            case RULE_RATE_ABOVE:
+                if( RatePerSecond(delta, elapsed_nanoseconds) > mapping->limit )
+                    LedsRequest( mapping->pin, LED_LEVEL_FULL );
+                break;
+
+            case RULE_BRIGHTNESS:
+                rate = RatePerSecond( delta, elapsed_nanoseconds );
+                if( rate >= mapping->limit )
+                    LedsRequest( mapping->pin, LED_LEVEL_FULL );
+                else
+                    LedsRequest( mapping->pin, ((rate * LED_LEVEL_FULL) + mapping->limit - 1) / mapping->limit );
+                break;
+        }
+    }
+
+    return 0;
+}
+
+
+/* Parse a "COUNTER:RULE[:N]@PIN" counter mapping */
+static bool ParseMapping( const char* spec )
+{
+    const char*        at_sign      = strrchr( spec, '@' );
+    const char*        rule_name    = strchr( spec, ':' );
+    const char*        limit_text;
+    char*              end;
+    counter_rule_t     rule;
+    unsigned long long limit        = 0;
+    long               pin;
+
+    if( (at_sign == NULL) || (rule_name == NULL) || (rule_name > at_sign) )
+        return false;
+
+    pin = strtol( at_sign + 1, &end, NUMERIC_OPTION_BASE );
+    if( (end == at_sign + 1) || (*end != '\0') || (pin < MIN_VALID_MAP_PIN) || (pin > MAX_VALID_MAP_PIN) )
+        return false;
+
+    rule_name++;
+    limit_text = memchr( rule_name, ':', at_sign - rule_name );
+
+    if( (limit_text == NULL) && ((size_t)(at_sign - rule_name) == strlen(RULE_CHANGED_NAME)) && (strncmp(rule_name, RULE_CHANGED_NAME, at_sign - rule_name) == 0) )
+    {
+        rule = RULE_CHANGED;
+    }
+    else if( limit_text != NULL )
+    {
+        if( ((size_t)(limit_text - rule_name) == strlen(RULE_RATE_ABOVE_NAME)) && (strncmp(rule_name, RULE_RATE_ABOVE_NAME, limit_text - rule_name) == 0) )
+            rule = RULE_RATE_ABOVE;
+        else if( ((size_t)(limit_text - rule_name) == strlen(RULE_BRIGHTNESS_NAME)) && (strncmp(rule_name, RULE_BRIGHTNESS_NAME, limit_text - rule_name) == 0) )
+            rule = RULE_BRIGHTNESS;
+        else
+            return false;
+
+        limit = strtoull( limit_text + 1, &end, NUMERIC_OPTION_BASE );
+        if( (end != at_sign) || (limit == 0) )
+            return false;
+    }
+    else
+    {
+        return false;
+    }
+
+    return AddMapping( spec, (rule_name - 1) - spec, rule, limit, pin );
+}
+
+
+/* Per-device LEDs (-b). Devices matching a pattern are watched while they exist: the kernel's
+ *  hot-plug events open and close their stat files, so a tick only reads the open ones */
+struct device_mapping
+{
+    char               pattern[MAX_DEVICE_NAME_LENGTH + 1];
+    unsigned int       pin;
+};
+
+struct watched_device
+{
+    char               name[MAX_DEVICE_NAME_LENGTH + 1];
+    int                stat_fd;
+    unsigned int       pin;
+    bool               primed;             /* Has a previous I/O count to compare with */
+    unsigned long long ios;                /* Reads plus writes completed */
+};
+
+static struct device_mapping  Device_Mappings[MAX_DEVICE_MAPPINGS];
+static unsigned int           Device_Mapping_Count      = 0;
+static struct watched_device  Watched_Devices[MAX_WATCHED_DEVICES];
+static unsigned int           Watched_Device_Count      = 0;
+static int                    Uevent_Fd                 = -1;
+
+
+/* Start watching a block device, if it matches one of the patterns */
+static void WatchDevice( const char* name )
+{
+    struct watched_device* device;
+    char                   stat_file_name[sizeof(BLOCK_DEVICE_DIRECTORY) + MAX_DEVICE_NAME_LENGTH + sizeof(BLOCK_DEVICE_STAT_FILE_NAME) + 1];
+    unsigned int           mapping;
+
+    if( (strlen(name) > MAX_DEVICE_NAME_LENGTH) || (Watched_Device_Count == MAX_WATCHED_DEVICES) )
+        return;
+
+    for( unsigned int index = 0; index < Watched_Device_Count; index++ )
+    {
+        if( strcmp(Watched_Devices[index].name, name) == 0 )
+            return;
+    }
+
+    for( mapping = 0; mapping < Device_Mapping_Count; mapping++ )
+    {
+        if( fnmatch(Device_Mappings[mapping].pattern, name, 0) == 0 )
             break;
+    }
+
+    if( mapping == Device_Mapping_Count )
+        return;
+
+    device = &Watched_Devices[Watched_Device_Count];
+    snprintf( stat_file_name, sizeof(stat_file_name), BLOCK_DEVICE_DIRECTORY "/%s/" BLOCK_DEVICE_STAT_FILE_NAME, name );
+
+    device->stat_fd = open( stat_file_name, O_RDONLY | O_CLOEXEC );
+    if( device->stat_fd < 0 )
+        return;
+
+    strcpy( device->name, name );
+    device->pin    = Device_Mappings[mapping].pin;
+    device->primed = false;
+    Watched_Device_Count++;
+}
+
+
+static void UnwatchDevice( const char* name )
+{
+    for( unsigned int index = 0; index < Watched_Device_Count; index++ )
+    {
+        if( strcmp(Watched_Devices[index].name, name) == 0 )
+        {
+            close( Watched_Devices[index].stat_fd );
+            Watched_Devices[index] = Watched_Devices[--Watched_Device_Count];
+            return;
         }
     }
+}
+
+
+/* Watch every matching block device present now; only at startup, and if hot-plug events were lost */
+static void ScanBlockDevices( void )
+{
+    DIR*           directory = opendir( BLOCK_DEVICE_DIRECTORY );
+    struct dirent* entry;
 
-    if( vm_stats_file_line_buffer != NULL )
-        free( vm_stats_file_line_buffer );
+    if( directory == NULL )
+        return;
+
+    while( (entry = readdir(directory)) != NULL )
+    {
+        if( entry->d_name[0] != '.' )
+            WatchDevice( entry->d_name );
+    }
 
-    return result;
+    closedir( directory );
 }
 
 
-/* Update the LEDs */
-void LedsOn( bool want_wrAct_on, bool want_rdAct_on )
+/* Apply the queued hot-plug events for whole disks */
+static int HandleUevents( int uevent_fd )
 {
-        static bool wrAct_on = true; /* Ensure the LEDs turn off on first call */
-        static bool rdAct_on = true;
+    static char   buffer[UEVENT_BUFFER_SIZE];
+    struct uevent event;
+    int           result;
 
-        if( (want_wrAct_on == wrAct_on) && (want_rdAct_on == rdAct_on) )
-                return;
+    while( (result = UeventRead(uevent_fd, buffer, sizeof(buffer), &event)) != 0 )
+    {
+        if( result < 0 )
+        {
+            if( errno != ENOBUFS )
+                return -1;
+
+            ScanBlockDevices();
+            continue;
+        }
 
-        if( want_wrAct_on || ((Option_Wr_Led_GPIO_Pin == Option_Rd_Led_GPIO_Pin) && want_rdAct_on) )
+        if( (event.action == NULL) || (event.name == NULL) || (event.subsystem == NULL) || (strcmp(event.subsystem, UEVENT_SUBSYSTEM_BLOCK) != 0)
+         || ((event.devtype != NULL) && (strcmp(event.devtype, UEVENT_DEVTYPE_DISK) != 0)) )
+            continue;
+
+        if( strcmp(event.action, UEVENT_ACTION_ADD) == 0 )
         {
-            digitalWrite( Option_Wr_Led_GPIO_Pin, HIGH );
-            wrAct_on = true;
+            WatchDevice( event.name );
         }
-        else
+        else if( strcmp(event.action, UEVENT_ACTION_REMOVE) == 0 )
+        {
+            UnwatchDevice( event.name );
+        }
+        else if( strcmp(event.action, UEVENT_ACTION_MOVE) == 0 )
+        {
+            if( event.old_name != NULL )
+                UnwatchDevice( event.old_name );
+            WatchDevice( event.name );
+        }
+    }
+
+    return 0;
+}
+
+
+/* CLOCK_MONOTONIC deadline delay from now */
+static void DeadlineAfter( const struct timespec* delay, struct timespec* deadline )
+{
+    clock_gettime( CLOCK_MONOTONIC, deadline );
+    deadline->tv_sec  += delay->tv_sec;
+    deadline->tv_nsec += delay->tv_nsec;
+    if( deadline->tv_nsec >= (long)NANOSECONDS_PER_SECOND )
+    {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= NANOSECONDS_PER_SECOND;
+    }
+}
+
+
+/* Time left until the deadline; false once it has passed */
+static bool TimeUntil( const struct timespec* deadline, struct timespec* remaining )
+{
+    struct timespec now;
+
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    remaining->tv_sec  = deadline->tv_sec - now.tv_sec;
+    remaining->tv_nsec = deadline->tv_nsec - now.tv_nsec;
+    if( remaining->tv_nsec < 0 )
+    {
+        remaining->tv_sec--;
+        remaining->tv_nsec += NANOSECONDS_PER_SECOND;
+    }
+
+    return (remaining->tv_sec >= 0);
+}
+
+
+/* Sleep for one poll interval, handling hot-plug events as they come in */
+static int WaitForTick( int uevent_fd, const struct timespec* delay )
+{
+    struct timespec deadline;
+
+    DeadlineAfter( delay, &deadline );
+
+    for( ;; )
+    {
+        struct pollfd   uevent_poll = { uevent_fd, POLLIN, 0 };
+        struct timespec remaining;
+
+        if( TimeUntil(&deadline, &remaining) == false )
+            return 0;
+
+        /* A signal ends the wait, like nanosleep() did */
+        if( ppoll(&uevent_poll, 1, &remaining, NULL) < 0 )
+            return -1;
+
+        if( ((uevent_poll.revents & POLLIN) != 0) && (HandleUevents(uevent_fd) != 0) )
+            return -1;
+    }
+}
+
+
+/* Compare each watched device's completed reads and writes with the last poll. Nothing is allocated */
+static void DeviceActivity( void )
+{
+    char stat_buffer[BLOCK_DEVICE_STAT_BUFFER_SIZE];
+
+    /* Backwards, so an entry moved into a removed one's place has already been seen */
+    for( unsigned int index = Watched_Device_Count; index-- > 0; )
+    {
+        struct watched_device* device = &Watched_Devices[index];
+        unsigned long long     ios    = 0;
+        ssize_t                length = TEMP_FAILURE_RETRY( pread(device->stat_fd, stat_buffer, sizeof(stat_buffer) - 1, 0) );
+        const char*            field  = stat_buffer;
+
+        /* Gone, and the remove event not seen yet */
+        if( length <= 0 )
+        {
+            UnwatchDevice( device->name );
+            continue;
+        }
+
+        stat_buffer[length] = '\0';
+
+        /* Fields: reads completed, reads merged, sectors read, time reading, writes completed, ... */
+        for( unsigned int field_number = 0; field_number <= 4; field_number++ )
+        {
+            unsigned long long value = 0;
+
+            while( *field == ' ' )
+                field++;
+
+            while( (*field >= '0') && (*field <= '9') )
+                value = (value * 10) + (*field++ - '0');
+
+            if( (field_number == 0) || (field_number == 4) )
+                ios += value;
+        }
+
+        if( (device->primed == true) && (ios != device->ios) )
+            LedsRequest( device->pin, LED_LEVEL_FULL );
+
+        device->ios    = ios;
+        device->primed = true;
+    }
+}
+
+
+/* Parse a "PATTERN@PIN" device mapping */
+static bool ParseDeviceMapping( const char* spec )
+{
+    const char* at_sign = strrchr( spec, '@' );
+    char*       end;
+    long        pin;
+
+    if( (at_sign == NULL) || (at_sign == spec) || ((size_t)(at_sign - spec) > MAX_DEVICE_NAME_LENGTH) || (Device_Mapping_Count == MAX_DEVICE_MAPPINGS) )
+        return false;
+
+    pin = strtol( at_sign + 1, &end, NUMERIC_OPTION_BASE );
+    if( (end == at_sign + 1) || (*end != '\0') || (pin < MIN_VALID_MAP_PIN) || (pin > MAX_VALID_MAP_PIN) )
+        return false;
+
+    memcpy( Device_Mappings[Device_Mapping_Count].pattern, spec, at_sign - spec );
+    Device_Mappings[Device_Mapping_Count].pattern[at_sign - spec] = '\0';
+    Device_Mappings[Device_Mapping_Count].pin                     = pin;
+    Device_Mapping_Count++;
+
+    return true;
+}
+
+
+/* Watched processes (-P). Each is read through its open /proc/PID/io, and its pidfd in an epoll set tells
+ *  us when it has exited. Processes watched by name are found again when they restart from the kernel's
+ *  process events (exec, fork, name change) rather than by walking /proc every tick */
+struct process_mapping
+{
+    char               pattern[MAX_PROCESS_NAME_LENGTH + 1];   /* Empty when watching a PID */
+    pid_t              pid;
+    unsigned int       pin;
+    bool               syscalls;           /* Count read and write system calls, not bytes of storage I/O */
+};
+
+struct watched_process
+{
+    pid_t              pid;
+    unsigned int       mapping;
+    int                io_fd;
+    int                pidfd;              /* -1 before Linux 5.3, where an exit shows as a failed read instead */
+    bool               primed;
+    unsigned long long count;
+};
+
+static struct process_mapping Process_Mappings[MAX_PROCESS_MAPPINGS];
+static unsigned int           Process_Mapping_Count     = 0;
+static bool                   Process_Names_Watched     = false;
+static struct watched_process Watched_Processes[MAX_WATCHED_PROCESSES];
+static unsigned int           Watched_Process_Count     = 0;
+static int                    Process_Epoll_Fd          = -1;
+static int                    Process_Events_Fd         = -1;
+static unsigned int           Process_Rescan_Ticks      = 0;   /* Without process events: ticks until /proc is walked again */
+
+
+/* Start watching a process for one of the mappings */
+static void WatchProcess( pid_t pid, unsigned int mapping )
+{
+    struct watched_process* process;
+    char                    io_file_name[sizeof(PROC_DIRECTORY) + 24 + sizeof(PROCESS_IO_FILE_NAME)];
+
+    if( Watched_Process_Count == MAX_WATCHED_PROCESSES )
+        return;
+
+    for( unsigned int index = 0; index < Watched_Process_Count; index++ )
+    {
+        if( (Watched_Processes[index].pid == pid) && (Watched_Processes[index].mapping == mapping) )
+            return;
+    }
+
+    process = &Watched_Processes[Watched_Process_Count];
+    snprintf( io_file_name, sizeof(io_file_name), PROC_DIRECTORY "/%d/" PROCESS_IO_FILE_NAME, (int)pid );
+
+    process->io_fd = open( io_file_name, O_RDONLY | O_CLOEXEC );
+    if( process->io_fd < 0 )
+        return;
+
+    process->pidfd = syscall( SYS_pidfd_open, pid, 0 );
+    if( process->pidfd >= 0 )
+    {
+        struct epoll_event exit_event = { .events = EPOLLIN, .data.fd = process->pidfd };
+
+        if( epoll_ctl(Process_Epoll_Fd, EPOLL_CTL_ADD, process->pidfd, &exit_event) != 0 )
+        {
+            close( process->pidfd );
+            process->pidfd = -1;
+        }
+    }
+
+    process->pid     = pid;
+    process->mapping = mapping;
+    process->primed  = false;
+    Watched_Process_Count++;
+}
+
+
+static void UnwatchProcessAt( unsigned int index )
+{
+    close( Watched_Processes[index].io_fd );
+
+    /* Closing the pidfd also takes it out of the epoll set */
+    if( Watched_Processes[index].pidfd >= 0 )
+        close( Watched_Processes[index].pidfd );
+
+    Watched_Processes[index] = Watched_Processes[--Watched_Process_Count];
+}
+
+
+/* Stop the watches that came from matching a process name, e.g. when the process runs another program */
+static void UnwatchProcessName( pid_t pid )
+{
+    for( unsigned int index = Watched_Process_Count; index-- > 0; )
+    {
+        if( (Watched_Processes[index].pid == pid) && (Process_Mappings[Watched_Processes[index].mapping].pattern[0] != '\0') )
+            UnwatchProcessAt( index );
+    }
+}
+
+
+static void WatchProcessName( pid_t pid, const char* name )
+{
+    for( unsigned int mapping = 0; mapping < Process_Mapping_Count; mapping++ )
+    {
+        if( (Process_Mappings[mapping].pattern[0] != '\0') && (fnmatch(Process_Mappings[mapping].pattern, name, 0) == 0) )
+            WatchProcess( pid, mapping );
+    }
+}
+
+
+/* The kernel's name for a process (at most MAX_PROCESS_NAME_LENGTH characters) */
+static bool ReadProcessName( pid_t pid, char* name )
+{
+    char    comm_file_name[sizeof(PROC_DIRECTORY) + 24 + sizeof(PROCESS_COMM_FILE_NAME)];
+    int     comm_fd;
+    ssize_t length;
+
+    snprintf( comm_file_name, sizeof(comm_file_name), PROC_DIRECTORY "/%d/" PROCESS_COMM_FILE_NAME, (int)pid );
+
+    comm_fd = open( comm_file_name, O_RDONLY | O_CLOEXEC );
+    if( comm_fd < 0 )
+        return false;
+
+    length = TEMP_FAILURE_RETRY( read(comm_fd, name, MAX_PROCESS_NAME_LENGTH + 1) );
+    close( comm_fd );
+
+    if( length <= 0 )
+        return false;
+
+    name[length - ((name[length - 1] == '\n') ? 1 : 0)] = '\0';
+
+    return true;
+}
+
+
+/* Watch every process whose name matches; at startup, if process events were lost, or without process events */
+static void ScanProcesses( void )
+{
+    DIR*           directory = opendir( PROC_DIRECTORY );
+    struct dirent* entry;
+
+    if( directory == NULL )
+        return;
+
+    while( (entry = readdir(directory)) != NULL )
+    {
+        char  name[MAX_PROCESS_NAME_LENGTH + 2];
+        char* end;
+        long  pid = strtol( entry->d_name, &end, 10 );
+
+        if( (end != entry->d_name) && (*end == '\0') && (ReadProcessName(pid, name) == true) )
+            WatchProcessName( pid, name );
+    }
+
+    closedir( directory );
+}
+
+
+/* Ask the kernel to start (PROC_CN_MCAST_LISTEN) or stop (PROC_CN_MCAST_IGNORE) sending process events.
+ *  The kernel answers with a PROC_EVENT_NONE event whose ack is ours + 1; every listener sees the answer,
+ *  so our PID is the ack, to tell ours from other programs' */
+static int SendProcessEventsOperation( int events_fd, enum proc_cn_mcast_op operation, uint32_t sequence )
+{
+    char             request[NLMSG_SPACE(sizeof(struct cn_msg) + sizeof(enum proc_cn_mcast_op))] __attribute__((aligned(NLMSG_ALIGNTO)));
+    struct nlmsghdr* header  = (struct nlmsghdr*)request;
+    struct cn_msg*   message = NLMSG_DATA( header );
+
+    memset( request, 0, sizeof(request) );
+    header->nlmsg_len  = sizeof(request);
+    header->nlmsg_type = NLMSG_DONE;
+    header->nlmsg_seq  = sequence;
+    header->nlmsg_pid  = getpid();
+    message->id.idx    = CN_IDX_PROC;
+    message->id.val    = CN_VAL_PROC;
+    message->seq       = sequence;
+    message->ack       = getpid();
+    message->len       = sizeof(operation);
+    memcpy( message->data, &operation, sizeof(operation) );
+
+    return (TEMP_FAILURE_RETRY(send(events_fd, request, sizeof(request), 0)) < 0) ? -1 : 0;
+}
+
+
+/* Wait briefly for the kernel's answer to a request. Without one (e.g. in a network namespace other
+ *  than the initial one, where requests are ignored) no events are coming either. Other processes'
+ *  events may arrive first; they are dropped, as the caller scans the processes next anyway */
+static int WaitForProcessEventsAck( int events_fd )
+{
+    static char           buffer[PROCESS_EVENT_BUFFER_SIZE] __attribute__((aligned(NLMSG_ALIGNTO)));
+    const struct timespec wait = { PROCESS_EVENTS_ACK_MILLISECONDS / 1000, (PROCESS_EVENTS_ACK_MILLISECONDS % 1000) * 1000000L };
+    struct timespec       deadline;
+
+    DeadlineAfter( &wait, &deadline );
+
+    for( ;; )
+    {
+        struct pollfd   events_poll = { events_fd, POLLIN, 0 };
+        struct timespec remaining;
+        ssize_t         length;
+
+        if( TimeUntil(&deadline, &remaining) == false )
+        {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+
+        if( (ppoll(&events_poll, 1, &remaining, NULL) < 0) && (errno != EINTR) )
+            return -1;
+
+        while( (length = recv(events_fd, buffer, sizeof(buffer), 0)) > 0 )
+        {
+            for( struct nlmsghdr* header = (struct nlmsghdr*)buffer; NLMSG_OK(header, (size_t)length); header = NLMSG_NEXT(header, length) )
+            {
+                struct cn_msg*     message = NLMSG_DATA( header );
+                struct proc_event* event   = (struct proc_event*)message->data;
+
+                if( (header->nlmsg_type != NLMSG_DONE) || (message->id.idx != CN_IDX_PROC) || (message->id.val != CN_VAL_PROC)
+                 || (message->ack != ((uint32_t)getpid() + 1)) || (event->what != PROC_EVENT_NONE) )
+                    continue;
+
+                if( event->event_data.ack.err != 0 )
+                {
+                    errno = event->event_data.ack.err;
+                    return -1;
+                }
+
+                return 0;
+            }
+        }
+
+        if( (length < 0) && (errno != EAGAIN) && (errno != EINTR) && (errno != ENOBUFS) )
+            return -1;
+    }
+}
+
+
+/* Subscribe to the proc connector's fork, exec and name change events. Needs CAP_NET_ADMIN */
+static int OpenProcessEvents( void )
+{
+    struct sockaddr_nl address       = { .nl_family = AF_NETLINK, .nl_groups = CN_IDX_PROC };
+    int                buffer_size   = PROCESS_EVENT_SOCKET_BUFFER_SIZE;
+    int                events_fd     = socket( AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_CONNECTOR );
+    int                error;
+
+    if( events_fd < 0 )
+        return -1;
+
+    /* Process events come in bursts (a shell script forks a lot); we only read them once per tick */
+    if( setsockopt(events_fd, SOL_SOCKET, SO_RCVBUFFORCE, &buffer_size, sizeof(buffer_size)) != 0 )
+        setsockopt( events_fd, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size) );
+
+    if( (bind(events_fd, (struct sockaddr*)&address, sizeof(address)) != 0)
+     || (SendProcessEventsOperation(events_fd, PROC_CN_MCAST_LISTEN, 1) != 0)
+     || (WaitForProcessEventsAck(events_fd) != 0) )
+    {
+        error = errno;
+        close( events_fd );
+        errno = error;
+        return -1;
+    }
+
+    return events_fd;
+}
+
+
+/* Apply the queued process events, then drop the processes whose pidfds say they have exited */
+static int HandleProcessEvents( void )
+{
+    static char        buffer[PROCESS_EVENT_BUFFER_SIZE] __attribute__((aligned(NLMSG_ALIGNTO)));
+    struct epoll_event exits[MAX_WATCHED_PROCESSES];
+    ssize_t            length;
+    int                exit_count;
+
+    while( (Process_Events_Fd >= 0) && ((length = recv(Process_Events_Fd, buffer, sizeof(buffer), 0)) != 0) )
+    {
+        if( length < 0 )
         {
-            digitalWrite( Option_Wr_Led_GPIO_Pin, LOW );
-            wrAct_on = false;
+            if( (errno == EAGAIN) || (errno == EINTR) )
+                break;
+
+            if( errno != ENOBUFS )
+            {
+                perror( PROCESS_EVENTS_READ_ERROR_MSG );
+                return -1;
+            }
+
+            ScanProcesses();
+            continue;
+        }
+
+        for( struct nlmsghdr* header = (struct nlmsghdr*)buffer; NLMSG_OK(header, (size_t)length); header = NLMSG_NEXT(header, length) )
+        {
+            struct cn_msg*     message = NLMSG_DATA( header );
+            struct proc_event* event   = (struct proc_event*)message->data;
+            char               name[MAX_PROCESS_NAME_LENGTH + 2];
+
+            if( (header->nlmsg_type != NLMSG_DONE) || (message->id.idx != CN_IDX_PROC) || (message->id.val != CN_VAL_PROC) )
+                continue;
+
+            switch( event->what )
+            {
+                case PROC_EVENT_EXEC:
+                    UnwatchProcessName( event->event_data.exec.process_tgid );
+                    if( ReadProcessName(event->event_data.exec.process_tgid, name) == true )
+                        WatchProcessName( event->event_data.exec.process_tgid, name );
+                    break;
+
+                case PROC_EVENT_COMM:
+                    if( event->event_data.comm.process_pid == event->event_data.comm.process_tgid )
+                    {
+                        memcpy( name, event->event_data.comm.comm, sizeof(event->event_data.comm.comm) );
+                        name[sizeof(event->event_data.comm.comm)] = '\0';
+                        UnwatchProcessName( event->event_data.comm.process_tgid );
+                        WatchProcessName( event->event_data.comm.process_tgid, name );
+                    }
+                    break;
+
+                case PROC_EVENT_FORK:
+                    /* A new process (not thread) has its parent's name, so it matches the same patterns */
+                    if( event->event_data.fork.child_pid == event->event_data.fork.child_tgid )
+                    {
+                        for( unsigned int index = 0; index < Watched_Process_Count; index++ )
+                        {
+                            if( (Watched_Processes[index].pid == event->event_data.fork.parent_tgid) && (Process_Mappings[Watched_Processes[index].mapping].pattern[0] != '\0') )
+                                WatchProcess( event->event_data.fork.child_tgid, Watched_Processes[index].mapping );
+                        }
+                    }
+                    break;
+
+                default:
+                    break;
+            }
         }
+    }
 
-        if( want_rdAct_on || ((Option_Wr_Led_GPIO_Pin == Option_Rd_Led_GPIO_Pin) && want_wrAct_on) )
+    exit_count = epoll_wait( Process_Epoll_Fd, exits, MAX_WATCHED_PROCESSES, 0 );
+    for( int exit_index = 0; exit_index < exit_count; exit_index++ )
+    {
+        for( unsigned int index = 0; index < Watched_Process_Count; index++ )
         {
-            digitalWrite( Option_Rd_Led_GPIO_Pin, HIGH );
-            rdAct_on = true;
+            if( Watched_Processes[index].pidfd == exits[exit_index].data.fd )
+            {
+                UnwatchProcessAt( index );
+                break;
+            }
         }
+    }
+
+    return 0;
+}
+
+
+/* Sum two of the "key: value" lines of /proc/PID/io, without allocating */
+static unsigned long long SumProcessIoFields( const char* text, const char* end, const char* first_key, const char* second_key )
+{
+    size_t             first_key_length  = strlen( first_key );
+    size_t             second_key_length = strlen( second_key );
+    unsigned long long sum               = 0;
+
+    while( text < end )
+    {
+        const char*        colon = memchr( text, ':', end - text );
+        size_t             key_length;
+        bool               wanted;
+        unsigned long long value = 0;
+
+        if( colon == NULL )
+            break;
+
+        key_length = colon - text;
+        wanted     = ((key_length == first_key_length) && (memcmp(text, first_key, key_length) == 0))
+                  || ((key_length == second_key_length) && (memcmp(text, second_key, key_length) == 0));
+
+        for( text = colon + 1; (text < end) && (*text == ' '); text++ )
+            ;
+
+        while( (text < end) && (*text >= '0') && (*text <= '9') )
+            value = (value * 10) + (*text++ - '0');
+
+        if( wanted == true )
+            sum += value;
+
+        while( (text < end) && (*text++ != '\n') )
+            ;
+    }
+
+    return sum;
+}
+
+
+/* Compare each watched process's I/O with the last poll */
+static int ProcessActivity( void )
+{
+    char io_buffer[PROCESS_IO_BUFFER_SIZE];
+
+    if( HandleProcessEvents() != 0 )
+        return -1;
+
+    if( (Process_Events_Fd < 0) && (Process_Names_Watched == true) && (--Process_Rescan_Ticks == 0) )
+    {
+        ScanProcesses();
+        Process_Rescan_Ticks = (PROCESS_RESCAN_MILLISECONDS + Option_Poll_Interval_Time - 1) / Option_Poll_Interval_Time;
+    }
+
+    for( unsigned int index = Watched_Process_Count; index-- > 0; )
+    {
+        struct watched_process* process  = &Watched_Processes[index];
+        ssize_t                 length   = TEMP_FAILURE_RETRY( pread(process->io_fd, io_buffer, sizeof(io_buffer), 0) );
+        bool                    syscalls = Process_Mappings[process->mapping].syscalls;
+        unsigned long long      count;
+
+        /* Exited, and no pidfd to say so */
+        if( length <= 0 )
+        {
+            UnwatchProcessAt( index );
+            continue;
+        }
+
+        if( syscalls == true )
+            count = SumProcessIoFields( io_buffer, io_buffer + length, PROCESS_IO_SYSCR_KEY, PROCESS_IO_SYSCW_KEY );
         else
+            count = SumProcessIoFields( io_buffer, io_buffer + length, PROCESS_IO_READ_BYTES_KEY, PROCESS_IO_WRITE_BYTES_KEY );
+
+        if( (process->primed == true) && (count != process->count) )
+            LedsRequest( Process_Mappings[process->mapping].pin, LED_LEVEL_FULL );
+
+        process->count  = count;
+        process->primed = true;
+    }
+
+    return 0;
+}
+
+
+/* Set up the epoll set and the process events, and find the processes to watch */
+static int OpenProcessWatches( void )
+{
+    Process_Epoll_Fd = epoll_create1( EPOLL_CLOEXEC );
+    if( Process_Epoll_Fd < 0 )
+    {
+        perror( PROCESS_EPOLL_ERROR_MSG );
+        return -1;
+    }
+
+    if( Process_Names_Watched == true )
+    {
+        Process_Events_Fd = OpenProcessEvents();
+        if( Process_Events_Fd < 0 )
         {
-            digitalWrite( Option_Rd_Led_GPIO_Pin, LOW );
-            rdAct_on = false;
+            perror( PROCESS_EVENTS_UNAVAILABLE_MSG );
+            Process_Rescan_Ticks = 1;
         }
+
+        ScanProcesses();
+    }
+
+    for( unsigned int mapping = 0; mapping < Process_Mapping_Count; mapping++ )
+    {
+        if( Process_Mappings[mapping].pattern[0] != '\0' )
+            continue;
+
+        WatchProcess( Process_Mappings[mapping].pid, mapping );
+        if( (Watched_Process_Count == 0) || (Watched_Processes[Watched_Process_Count - 1].pid != Process_Mappings[mapping].pid) )
+            fprintf( stderr, "%d: %s\n", (int)Process_Mappings[mapping].pid, PROCESS_NOT_FOUND_MSG );
+    }
+
+    return 0;
+}
+
+
+static void CloseProcessWatches( void )
+{
+    while( Watched_Process_Count > 0 )
+        UnwatchProcessAt( 0 );
+
+    /* Tell the kernel it can stop generating events, if nobody else listens */
+    if( Process_Events_Fd >= 0 )
+    {
+        SendProcessEventsOperation( Process_Events_Fd, PROC_CN_MCAST_IGNORE, 2 );
+        close( Process_Events_Fd );
+    }
+
+    if( Process_Epoll_Fd >= 0 )
+        close( Process_Epoll_Fd );
+}
+
+
+/* Parse "PID@PIN" or "NAME@PIN", optionally followed by ":syscalls" */
+static bool ParseProcessMapping( const char* spec )
+{
+    struct process_mapping* mapping = &Process_Mappings[Process_Mapping_Count];
+    const char*             at_sign = strrchr( spec, '@' );
+    char*                   end;
+    long                    value;
+
+    if( (at_sign == NULL) || (at_sign == spec) || ((size_t)(at_sign - spec) > MAX_PROCESS_NAME_LENGTH) || (Process_Mapping_Count == MAX_PROCESS_MAPPINGS) )
+        return false;
+
+    memset( mapping, 0, sizeof(*mapping) );
+
+    value = strtol( at_sign + 1, &end, NUMERIC_OPTION_BASE );
+    if( (end == at_sign + 1) || (value < MIN_VALID_MAP_PIN) || (value > MAX_VALID_MAP_PIN) )
+        return false;
+    mapping->pin = value;
+
+    if( *end == ':' )
+    {
+        if( strcmp(end + 1, PROCESS_SYSCALLS_RULE_NAME) != 0 )
+            return false;
+        mapping->syscalls = true;
+    }
+    else if( *end != '\0' )
+    {
+        return false;
+    }
+
+    /* All digits: a PID */
+    value = strtol( spec, &end, 10 );
+    if( (end == at_sign) && (value > 0) )
+    {
+        mapping->pid = value;
+    }
+    else
+    {
+        memcpy( mapping->pattern, spec, at_sign - spec );
+        mapping->pattern[at_sign - spec] = '\0';
+        Process_Names_Watched            = true;
+    }
+
+    Process_Mapping_Count++;
+
+    return true;
 }
 
 
@@ -201,6 +1269,28 @@ error_t ParseOptions( int key, char* arg, struct argp_state* state )
             Option_Detach = true;
             break;
 
+        case OPTION_SIMULATE_KEY:
+            Option_Waveform_File_Name = arg;
+            break;
+
+        case OPTION_STATS_FILE_KEY:
+            Option_Stats_File_Name = arg;
+            break;
+
+        case OPTION_DEVICE_KEY:
+            if( ParseDeviceMapping(arg) == false )
+                argp_failure( state, EXIT_FAILURE, 0, INVALID_DEVICE_OPTION_MESSAGE );
+            break;
+
+        case OPTION_UEVENT_SOCKET_KEY:
+            Option_Uevent_Socket_Path = arg;
+            break;
+
+        case OPTION_PROCESS_KEY:
+            if( ParseProcessMapping(arg) == false )
+                argp_failure( state, EXIT_FAILURE, 0, INVALID_PROCESS_OPTION_MESSAGE );
+            break;
+
         case OPTION_POLL_TIME_KEY:
             Option_Poll_Interval_Time = strtol( arg, NULL, NUMERIC_OPTION_BASE );
             if( Option_Poll_Interval_Time < MIN_POLL_TIME_MILLISECONDS )
@@ -219,6 +1309,30 @@ error_t ParseOptions( int key, char* arg, struct argp_state* state )
                 argp_failure( state, EXIT_FAILURE, 0, INVALID_RD_PIN_OPTION_MESSAGE );
             break;
 
+        case OPTION_RATE_REPORT_KEY:
+            Option_Rate_Report_File_Name = arg;
+            break;
+
+        case OPTION_REPORT_INTERVAL_KEY:
+            Option_Rate_Report_Interval = strtol( arg, NULL, NUMERIC_OPTION_BASE );
+            if( (Option_Rate_Report_Interval < RATE_REPORT_MIN_INTERVAL_SECONDS) || (Option_Rate_Report_Interval > RATE_REPORT_MAX_INTERVAL_SECONDS) )
+                argp_failure( state, EXIT_FAILURE, 0, INVALID_REPORT_INTERVAL_MESSAGE );
+            break;
+
+        case OPTION_BAR_GRAPH_KEY:
+            if( BarGraphParse(arg, &Option_Bar_Graph) == false )
+                argp_failure( state, EXIT_FAILURE, 0, INVALID_BAR_GRAPH_OPTION_MESSAGE );
+            Option_Use_Bar_Graph = true;
+            break;
+
+        case OPTION_MAP_KEY:
+            if( Option_Map_Count == MAX_COUNTER_MAPPINGS )
+                argp_failure( state, EXIT_FAILURE, 0, TOO_MANY_MAPS_OPTION_MESSAGE );
+            if( ParseMapping(arg) == false )
+                argp_failure( state, EXIT_FAILURE, 0, INVALID_MAP_OPTION_MESSAGE );
+            Option_Map_Count++;
+            break;
+
         default:
             return ARGP_ERR_UNKNOWN;
             break;
@@ -236,6 +1350,15 @@ int main( int argc, char **argv )
             { OPTION_POLL_TIME_NAME, OPTION_POLL_TIME_KEY, OPTION_POLL_TIME_ARG_TYPE, 0, OPTION_POLL_TIME_DOCUMENTATION, 0 },
             {    OPTION_RD_PIN_NAME,    OPTION_RD_PIN_KEY,    OPTION_RD_PIN_ARG_TYPE, 0,    OPTION_RD_PIN_DOCUMENTATION, 0 },
             {    OPTION_WR_PIN_NAME,    OPTION_WR_PIN_KEY,    OPTION_WR_PIN_ARG_TYPE, 0,    OPTION_WR_PIN_DOCUMENTATION, 0 },
+            {       OPTION_MAP_NAME,       OPTION_MAP_KEY,       OPTION_MAP_ARG_TYPE, 0,       OPTION_MAP_DOCUMENTATION, 0 },
+            { OPTION_BAR_GRAPH_NAME, OPTION_BAR_GRAPH_KEY, OPTION_BAR_GRAPH_ARG_TYPE, 0, OPTION_BAR_GRAPH_DOCUMENTATION, 0 },
+            { OPTION_RATE_REPORT_NAME, OPTION_RATE_REPORT_KEY, OPTION_RATE_REPORT_ARG_TYPE, 0, OPTION_RATE_REPORT_DOCUMENTATION, 0 },
+            { OPTION_REPORT_INTERVAL_NAME, OPTION_REPORT_INTERVAL_KEY, OPTION_REPORT_INTERVAL_ARG_TYPE, 0, OPTION_REPORT_INTERVAL_DOCUMENTATION, 0 },
+            {    OPTION_DEVICE_NAME,    OPTION_DEVICE_KEY,    OPTION_DEVICE_ARG_TYPE, 0,    OPTION_DEVICE_DOCUMENTATION, 0 },
+            { OPTION_UEVENT_SOCKET_NAME, OPTION_UEVENT_SOCKET_KEY, OPTION_UEVENT_SOCKET_ARG_TYPE, 0, OPTION_UEVENT_SOCKET_DOCUMENTATION, 0 },
+            {   OPTION_PROCESS_NAME,   OPTION_PROCESS_KEY,   OPTION_PROCESS_ARG_TYPE, 0,   OPTION_PROCESS_DOCUMENTATION, 0 },
+            {  OPTION_SIMULATE_NAME,  OPTION_SIMULATE_KEY,  OPTION_SIMULATE_ARG_TYPE, 0,  OPTION_SIMULATE_DOCUMENTATION, 0 },
+            {OPTION_STATS_FILE_NAME,OPTION_STATS_FILE_KEY,OPTION_STATS_FILE_ARG_TYPE, 0,OPTION_STATS_FILE_DOCUMENTATION, 0 },
             { 0 }
         };
 
@@ -246,12 +1369,14 @@ int main( int argc, char **argv )
                 NULL, NULL, NULL
         };
 
-        int   status      = EXIT_FAILURE;
-        FILE* fp_vmstat   = NULL;
-        bool  wr_activity = false;
-        bool  rd_activity = false;
+        int   status          = EXIT_FAILURE;
+        bool  detached_parent = false;
+        int   vmstat_fd       = -1;
+        int   wr_counter;
+        int   rd_counter;
 
         struct timespec delay;
+        struct timespec last_poll;
 
         /* Parse the command-line */
         parser.options = options;
@@ -261,24 +1386,74 @@ int main( int argc, char **argv )
         delay.tv_sec  = Option_Poll_Interval_Time / 1000;
         delay.tv_nsec = 1000000 * (Option_Poll_Interval_Time % 1000);
 
+        /* The read and write LEDs are the two default counter mappings */
+        AddMapping( DEFAULT_WR_COUNTER_NAME, strlen(DEFAULT_WR_COUNTER_NAME), RULE_CHANGED, 0, Option_Wr_Led_GPIO_Pin );
+        AddMapping( DEFAULT_RD_COUNTER_NAME, strlen(DEFAULT_RD_COUNTER_NAME), RULE_CHANGED, 0, Option_Rd_Led_GPIO_Pin );
+        wr_counter = AddCounter( DEFAULT_WR_COUNTER_NAME, strlen(DEFAULT_WR_COUNTER_NAME) );
+        rd_counter = AddCounter( DEFAULT_RD_COUNTER_NAME, strlen(DEFAULT_RD_COUNTER_NAME) );
+
         /* Ensure the LEDs are off */
-        wiringPiSetup();
-        pinMode( Option_Rd_Led_GPIO_Pin, OUTPUT );
-        pinMode( Option_Wr_Led_GPIO_Pin, OUTPUT );
-        LedsOn( false, false );
+        if( GpioSetup(Option_Waveform_File_Name) != 0 )
+            goto out;
+        for( unsigned int index = 0; index < Mapping_Count; index++ )
+        {
+            if( Mappings[index].rule != RULE_BRIGHTNESS )
+                LedsAddPin( Mappings[index].pin, false );
+        }
+
+        for( unsigned int index = 0; index < Device_Mapping_Count; index++ )
+            LedsAddPin( Device_Mappings[index].pin, false );
+
+        for( unsigned int index = 0; index < Process_Mapping_Count; index++ )
+            LedsAddPin( Process_Mappings[index].pin, false );
+
+        /* The bar graph shows the combined page in/out rate */
+        if( (Option_Use_Bar_Graph == true) && (ShiftRegisterOpen(&Option_Bar_Graph.output) != 0) )
+            goto out;
+
+        /* Histograms of the per-poll rates of the read and write counters */
+        if( Option_Rate_Report_File_Name != NULL )
+        {
+            if( RateReportOpen(&Rate_Report, Option_Rate_Report_File_Name, Option_Rate_Report_Interval) != 0 )
+                goto out;
+            RateReportAddSource( &Rate_Report, Counters[rd_counter].name );
+            RateReportAddSource( &Rate_Report, Counters[wr_counter].name );
+        }
 
         /* Open the vmstat file */
-        fp_vmstat = fopen( VM_STATS_FILE_NAME, "r" );
-        if( fp_vmstat == NULL )
+        vmstat_fd = open( Option_Stats_File_Name, O_RDONLY | O_CLOEXEC );
+        if( vmstat_fd < 0 )
         {
-            perror( VM_STATS_FILE_OPEN_ERROR_MSG );
+            perror( Option_Stats_File_Name );
             goto out;
         }
 
+        /* Subscribe to hot-plug events before looking at the devices, so none slips through in between */
+        if( Device_Mapping_Count > 0 )
+        {
+            Uevent_Fd = UeventOpen( Option_Uevent_Socket_Path );
+            if( Uevent_Fd < 0 )
+                goto out;
+
+            ScanBlockDevices();
+        }
+
+        /* Process events are subscribed to before looking for the processes, for the same reason */
+        if( (Process_Mapping_Count > 0) && (OpenProcessWatches() != 0) )
+            goto out;
+
         /* Save the current I/O stat values */
-        if( Activity(fp_vmstat, &wr_activity, &rd_activity) != 0 )
+        if( (Activity(vmstat_fd, 0) != 0) || (ProcessActivity() != 0) )
             goto out;
 
+        DeviceActivity();
+
+        for( unsigned int index = 0; index < Counter_Count; index++ )
+        {
+            if( Counters[index].found == false )
+                fprintf( stderr, "%s: %s\n", Counters[index].name, COUNTER_NOT_FOUND_MSG );
+        }
+
         /* Detach from terminal? */
         if( Option_Detach == true )
         {
@@ -292,7 +1467,8 @@ int main( int argc, char **argv )
             if( child > 0 )
             {
                 /* I am the parent */
-                status = EXIT_SUCCESS;
+                status          = EXIT_SUCCESS;
+                detached_parent = true;
                 goto out;
             }
         }
@@ -313,30 +1489,98 @@ int main( int argc, char **argv )
             sigaction( SIGTERM, &sig_action, NULL );
         }
 
+        /* softPwm runs a thread per dimmable pin, which would not have survived the fork */
+        for( unsigned int index = 0; index < Mapping_Count; index++ )
+        {
+            if( Mappings[index].rule == RULE_BRIGHTNESS )
+                LedsAddPin( Mappings[index].pin, true );
+        }
+
+        clock_gettime( CLOCK_MONOTONIC, &last_poll );
+
+        if( Rate_Report.output != NULL )
+            RateReportStart( &Rate_Report, &last_poll );
+
         /* Loop until signal received */
         while( Keep_Running == true )
         {
-                int activity_result;
+                int                activity_result;
+                struct timespec    now;
+                unsigned long long elapsed_nanoseconds;
 
-                if( nanosleep(&delay, NULL) < 0 )
+                if( Uevent_Fd >= 0 )
+                {
+                        if( WaitForTick(Uevent_Fd, &delay) != 0 )
+                                break;
+                }
+                else if( nanosleep(&delay, NULL) < 0 )
+                {
                         break;
+                }
+
+                clock_gettime( CLOCK_MONOTONIC, &now );
+                elapsed_nanoseconds = ((now.tv_sec - last_poll.tv_sec) * NANOSECONDS_PER_SECOND) + now.tv_nsec - last_poll.tv_nsec;
+                last_poll           = now;
 
-                activity_result = Activity( fp_vmstat, &wr_activity, &rd_activity );
+                activity_result = Activity( vmstat_fd, elapsed_nanoseconds );
 
                 if( activity_result != 0 )
                         break;
 
-                LedsOn( wr_activity, rd_activity );
+                if( (Process_Mapping_Count > 0) && (ProcessActivity() != 0) )
+                        break;
+
+                DeviceActivity();
+                LedsUpdate();
+
+                if( (Option_Use_Bar_Graph == true)
+                 && (ShiftRegisterUpdate(&Option_Bar_Graph.output, BarGraphFrame(&Option_Bar_Graph, RatePerSecond(Counters[wr_counter].delta + Counters[rd_counter].delta, elapsed_nanoseconds))) != 0) )
+                        break;
+
+                if( Rate_Report.output != NULL )
+                {
+                        RateHistogramRecord( &Rate_Report.sources[0], RatePerSecond(Counters[rd_counter].delta, elapsed_nanoseconds) );
+                        RateHistogramRecord( &Rate_Report.sources[1], RatePerSecond(Counters[wr_counter].delta, elapsed_nanoseconds) );
+                        if( RateReportTick(&Rate_Report, &now) != 0 )
+                                break;
+                }
         }
 
         status = EXIT_SUCCESS;
 
 out:
         /* Ensure the LEDs are off */
-        LedsOn( false, false );
+        LedsOff();
+
+        /* The child drives the registers now; shifting a dark frame from here could garble its next one */
+        if( (Option_Use_Bar_Graph == true) && (detached_parent == false) )
+            ShiftRegisterClose( &Option_Bar_Graph.output );
+
+        /* The last, partial, interval still gets its line */
+        {
+            struct timespec now;
+
+            clock_gettime( CLOCK_MONOTONIC, &now );
+            RateReportClose( &Rate_Report, &now );
+        }
+
+        if( vmstat_fd >= 0 )
+            close( vmstat_fd );
+
+        while( Watched_Device_Count > 0 )
+            UnwatchDevice( Watched_Devices[0].name );
+
+        /* The child goes on reading the injection socket; the parent must not remove it */
+        if( detached_parent == false )
+            UeventClose( Uevent_Fd, Option_Uevent_Socket_Path );
+
+        /* The subscription is shared with the child; the parent's IGNORE would end it */
+        if( detached_parent == false )
+            CloseProcessWatches();
 
-        if( fp_vmstat != NULL )
-            fclose( fp_vmstat );
+        /* The child records the rest of the waveform; only it writes the file */
+        if( detached_parent == false )
+            GpioFinish();
 
         return status;
 }
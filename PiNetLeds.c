@@ -41,7 +41,7 @@
  *
  *
  * To compile:
- *   gcc PiNetLeds.c -std=gnu11 -Wall -O3 -o PiNetLeds -lwiringPi
+ *   make PiNetLeds
  *
  * 
  * NOTE: The default LED pin for both receive and transmit activity is
@@ -57,6 +57,14 @@
 #define _GNU_SOURCE
 
 #include <argp.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -64,132 +72,1246 @@
 #include <time.h>
 #include <unistd.h>
 #include <stdbool.h>
+#include <arpa/inet.h>
+#include <linux/filter.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
 
-#include <wiringPi.h>
+#include "macroasstring.h"
+#include "gpio.h"
+#include "leds.h"
+#include "pinetleds.h"
+#include "ratehistogram.h"
+#include "shiftregister.h"
+#include "uevent.h"
+#include "pinetledsstrings.h"
+
+#define VERSION_MAJOR                     0
+#define VERSION_MINOR                     1
+
+/* Version string for GLIBC's argp helper functions */
+const char*          argp_program_version      = "PiNetLeds v" MACRO_VALUE_AS_STRING(VERSION_MAJOR) "." MACRO_VALUE_AS_STRING(VERSION_MINOR);
+
+static unsigned int  Option_Poll_Interval_Time = DEFAULT_POLL_TIME_MILLISECONDS;
+static unsigned int  Option_Tx_Led_GPIO_Pin    = DEFAULT_TX_LED_GPIO_PIN;        /* wiringPi numbering scheme */
+static unsigned int  Option_Rx_Led_GPIO_Pin    = DEFAULT_RX_LED_GPIO_PIN;        /* wiringPi numbering scheme */
+static bool          Option_Detach             = false;
+static const char*   Option_Waveform_File_Name = NULL;                           /* Simulate the GPIO pins, recording to this file */
+static const char*   Option_Stats_File_Name    = NETWORK_STATS_FILE_NAME;
+static bool          Option_Packet_Capture     = false;
+static const char*   Option_Capture_Interface  = NULL;                           /* NULL: all but loopback */
+static unsigned int  Option_Capture_Latency    = DEFAULT_CAPTURE_LATENCY_MILLISECONDS; /* Block retire timeout */
+static const char*   Option_Uevent_Socket_Path = NULL;                           /* NULL: hot-plug events from the kernel */
+static bool          Option_Use_Bar_Graph      = false;
+static struct bar_graph Option_Bar_Graph;
+static const char*   Option_Rate_Report_File_Name = NULL;                        /* NULL: no rate histograms */
+static unsigned int  Option_Rate_Report_Interval  = RATE_REPORT_DEFAULT_INTERVAL_SECONDS;
+static struct rate_report Rate_Report;
+
+static volatile bool Keep_Running              = true;
+
+
+/* Network interfaces, kept up to date from rtnetlink link notifications */
+struct interface_entry
+{
+    int                ifindex;
+    char               name[IFNAMSIZ];
+    bool               loopback;
+    bool               running;
+    unsigned int       rx_packets;         /* Last counts read from the statistics file, kept while the link is down */
+    unsigned int       tx_packets;
+    bool               listed;             /* Seen in the current resynchronisation dump */
+};
+
+static struct interface_entry Interfaces[MAX_INTERFACES];
+static unsigned int           Interface_Count           = 0;
+static unsigned int           Running_Interface_Count   = 0;             /* Operationally up, not counting loopback */
+static int                    Link_Monitor_Fd           = -1;
+static bool                   Link_Resync_Pending       = false;         /* A dump after lost notifications is under way */
+
+
+/* Ask the kernel for a dump of every link; the replies arrive through ReadLinkEvents() like any other notification */
+static int RequestLinkDump( int monitor_fd )
+{
+    struct
+    {
+        struct nlmsghdr  header;
+        struct ifinfomsg link;
+    } request;
+
+    memset( &request, 0, sizeof(request) );
+    request.header.nlmsg_len   = NLMSG_LENGTH( sizeof(request.link) );
+    request.header.nlmsg_type  = RTM_GETLINK;
+    request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    request.link.ifi_family    = AF_UNSPEC;
+
+    return (TEMP_FAILURE_RETRY( send(monitor_fd, &request, request.header.nlmsg_len, 0) ) < 0) ? -1 : 0;
+}
+
+
+static struct interface_entry* FindInterface( int ifindex )
+{
+    for( unsigned int index = 0; index < Interface_Count; index++ )
+    {
+        if( Interfaces[index].ifindex == ifindex )
+            return &Interfaces[index];
+    }
+
+    return NULL;
+}
+
+
+static void CountRunningInterfaces( void )
+{
+    Running_Interface_Count = 0;
+    for( unsigned int index = 0; index < Interface_Count; index++ )
+    {
+        if( (Interfaces[index].running == true) && (Interfaces[index].loopback == false) )
+            Running_Interface_Count++;
+    }
+}
+
+
+/* Apply one RTM_NEWLINK or RTM_DELLINK message to the interface table */
+static void UpdateInterface( const struct nlmsghdr* message )
+{
+    const struct ifinfomsg* link      = NLMSG_DATA( message );
+    struct interface_entry* entry     = FindInterface( link->ifi_index );
+    int                     remaining = IFLA_PAYLOAD( message );
+
+    if( message->nlmsg_type == RTM_DELLINK )
+    {
+        if( entry != NULL )
+            *entry = Interfaces[--Interface_Count];
+    }
+    else
+    {
+        if( entry == NULL )
+        {
+            if( Interface_Count == MAX_INTERFACES )
+                return;
+
+            entry = &Interfaces[Interface_Count++];
+            memset( entry, 0, sizeof(*entry) );
+            entry->ifindex = link->ifi_index;
+        }
+
+        entry->listed   = true;
+        entry->loopback = ((link->ifi_flags & IFF_LOOPBACK) != 0);
+        entry->running  = ((link->ifi_flags & IFF_RUNNING) != 0);
+
+        for( const struct rtattr* attribute = IFLA_RTA( link ); RTA_OK(attribute, remaining); attribute = RTA_NEXT(attribute, remaining) )
+        {
+            if( attribute->rta_type == IFLA_IFNAME )
+                strncpy( entry->name, RTA_DATA(attribute), sizeof(entry->name) - 1 );
+        }
+    }
+
+    CountRunningInterfaces();
+}
+
+
+/* End of a resynchronisation dump: links it did not list were removed while notifications were lost */
+static void DropUnlistedInterfaces( void )
+{
+    for( unsigned int index = Interface_Count; index > 0; index-- )
+    {
+        if( Interfaces[index - 1].listed == false )
+            Interfaces[index - 1] = Interfaces[--Interface_Count];
+    }
+
+    CountRunningInterfaces();
+}
+
+
+/* Drain the link notifications queued on the (nonblocking) monitor socket */
+int ReadLinkEvents( int monitor_fd )
+{
+    static char buffer[LINK_EVENT_BUFFER_SIZE] __attribute__(( aligned(NLMSG_ALIGNTO) ));
+
+    for( ;; )
+    {
+        ssize_t length = TEMP_FAILURE_RETRY( recv(monitor_fd, buffer, sizeof(buffer), 0) );
+
+        if( length < 0 )
+        {
+            if( (errno == EAGAIN) || (errno == EWOULDBLOCK) )
+                return 0;
+
+            /* Notifications were lost: resynchronise from a full dump. The table is kept, so links that
+             *  are down keep their last counts; the ones the dump does not list are dropped at its end */
+            if( errno == ENOBUFS )
+            {
+                for( unsigned int index = 0; index < Interface_Count; index++ )
+                    Interfaces[index].listed = false;
+
+                if( RequestLinkDump(monitor_fd) == 0 )
+                {
+                    Link_Resync_Pending = true;
+                    continue;
+                }
+            }
+
+            perror( LINK_MONITOR_READ_ERROR_MSG );
+            return -1;
+        }
+
+        for( struct nlmsghdr* message = (struct nlmsghdr*)buffer; NLMSG_OK(message, (size_t)length); message = NLMSG_NEXT(message, length) )
+        {
+            if( (message->nlmsg_type == RTM_NEWLINK) || (message->nlmsg_type == RTM_DELLINK) )
+                UpdateInterface( message );
+            else if( (message->nlmsg_type == NLMSG_DONE) && (Link_Resync_Pending == true) )
+            {
+                Link_Resync_Pending = false;
+                DropUnlistedInterfaces();
+            }
+        }
+    }
+}
+
+
+/* Subscribe to link notifications and fill the interface table; -1 if rtnetlink is not available */
+int OpenLinkMonitor( void )
+{
+    struct sockaddr_nl address;
+    struct pollfd      dump_poll;
+    int                monitor_fd = socket( AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_ROUTE );
+
+    if( monitor_fd < 0 )
+        return -1;
+
+    memset( &address, 0, sizeof(address) );
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = RTMGRP_LINK;
+
+    if( (bind(monitor_fd, (struct sockaddr*)&address, sizeof(address)) != 0) || (RequestLinkDump(monitor_fd) != 0) )
+    {
+        close( monitor_fd );
+        return -1;
+    }
+
+    /* Wait for the dump, so the first poll already knows which links are up */
+    dump_poll.fd     = monitor_fd;
+    dump_poll.events = POLLIN;
+    if( (TEMP_FAILURE_RETRY( poll(&dump_poll, 1, LINK_DUMP_TIMEOUT_MILLISECONDS) ) <= 0) || (ReadLinkEvents(monitor_fd) != 0) )
+    {
+        close( monitor_fd );
+        return -1;
+    }
+
+    return monitor_fd;
+}
+
+
+static struct interface_entry* FindInterfaceByName( const char* name, size_t name_length )
+{
+    if( name_length >= IFNAMSIZ )
+        return NULL;
+
+    for( unsigned int index = 0; index < Interface_Count; index++ )
+    {
+        if( (strncmp(Interfaces[index].name, name, name_length) == 0) && (Interfaces[index].name[name_length] == '\0') )
+            return &Interfaces[index];
+    }
+
+    return NULL;
+}
+
+
+/* Reread the network statistics file */
+int Activity( FILE* netstatsfile, bool* p_txAct, bool* p_rxAct, unsigned long long* p_tx_packets, unsigned long long* p_rx_packets )
+{
+        static unsigned int prev_total_rx_packets         = 0;
+        static unsigned int prev_total_tx_packets         = 0;
+
+        unsigned int        cur_total_rx_packets          = 0;
+        unsigned int        cur_total_tx_packets          = 0;
+        char*               netstatsfile_line_buffer      = NULL; // Let getline() worry about the line length
+        size_t              netstatsfile_line_buffer_size = 0;
+
+        int                 result;
+ 
+        /* Go to the beginning of the network statistics file */
+        result = TEMP_FAILURE_RETRY( fseek(netstatsfile, 0L, SEEK_SET) );
+        if( result != 0 )
+        {
+            perror( NETWORK_STATS_FILE_SEEK_ERROR_MSG );
+            return result;
+        }
+
+        /* Clear glibc's buffer */
+        result = TEMP_FAILURE_RETRY( fflush(netstatsfile) );
+        if( result != 0 )
+        {
+            perror( FILE_BUFFER_FLUSH_ERROR_MSG );
+            return result;
+        }
+
+        /* Extract the I/O stats */
+        while( (getline(&netstatsfile_line_buffer, &netstatsfile_line_buffer_size, netstatsfile) != -1) && (errno != EINTR) )
+        {
+            unsigned int            this_dev_rx_packets = 0;
+            unsigned int            this_dev_tx_packets = 0;
+            char*                   dev_name            = netstatsfile_line_buffer + strspn( netstatsfile_line_buffer, " " );
+            size_t                  dev_name_length     = strcspn( dev_name, ":" );
+            struct interface_entry* entry;
+
+            /* The two header lines have no colon */
+            if( dev_name[dev_name_length] != ':' )
+                continue;
+
+            /* Without the link monitor, only the loopback device is skipped */
+            if( Link_Monitor_Fd < 0 )
+            {
+                if( strncmp(dev_name, DEFAULT_NET_LOOPBACK_DEVICE_NAME, strlen(DEFAULT_NET_LOOPBACK_DEVICE_NAME)) == 0 )
+                    continue;
+
+                entry = NULL;
+            }
+            else
+            {
+                /* The link table says which lines are worth parsing: not loopback, and not links that are down,
+                 *  whose counts cannot have moved. Their last counts stay in the totals, so these do not drop */
+                entry = FindInterfaceByName( dev_name, dev_name_length );
+
+                if( (entry != NULL) && (entry->loopback == true) )
+                    continue;
+
+                if( (entry != NULL) && (entry->running == false) )
+                {
+                    cur_total_rx_packets += entry->rx_packets;
+                    cur_total_tx_packets += entry->tx_packets;
+                    continue;
+                }
+            }
+
+            /* The format of the network statistics file is assumed to be one line per network device, each of which contains the following (@=to be ignored):
+             *  Network interface name and a colon (the first number may follow without a space),
+             *  @rx bytes, rx packets, @rx errs, @rx drop, @rx fifo, @rx frame, @rx compressed, @rx multicast,
+             *  @tx bytes, tx packets, @tx errs, @tx drop, @tx fifo, @tx colls, @tx carrier, @tx compressed
+             */
+            if( sscanf(dev_name + dev_name_length + 1, "%*u %u %*u %*u %*u %*u %*u %*u %*u %u", &this_dev_rx_packets, &this_dev_tx_packets) == 2 )
+            {
+                cur_total_rx_packets += this_dev_rx_packets;
+                cur_total_tx_packets += this_dev_tx_packets;
+
+                if( entry != NULL )
+                {
+                    entry->rx_packets = this_dev_rx_packets;
+                    entry->tx_packets = this_dev_tx_packets;
+                }
+            }
+        }
+
+        /* Anything changed? A total that went down (an interface removed) is not traffic, but becomes the new base */
+        *p_txAct      = (cur_total_tx_packets > prev_total_tx_packets);
+        *p_rxAct      = (cur_total_rx_packets > prev_total_rx_packets);
+        *p_tx_packets = (*p_txAct == true) ? (cur_total_tx_packets - prev_total_tx_packets) : 0;
+        *p_rx_packets = (*p_rxAct == true) ? (cur_total_rx_packets - prev_total_rx_packets) : 0;
+
+        prev_total_tx_packets = cur_total_tx_packets;
+        prev_total_rx_packets = cur_total_rx_packets;
+
+        if( netstatsfile_line_buffer != NULL )
+            free( netstatsfile_line_buffer );
+
+        return result;
+}
+
+
+/* Update the LEDs, together with any per-interface LEDs requested on this tick */
+void LedsOn( bool want_txAct_on, bool want_rxAct_on )
+{
+        if( want_txAct_on == true )
+            LedsRequest( Option_Tx_Led_GPIO_Pin, LED_LEVEL_FULL );
+
+        if( want_rxAct_on == true )
+            LedsRequest( Option_Rx_Led_GPIO_Pin, LED_LEVEL_FULL );
+
+        LedsUpdate();
+}
+
+
+/* Per-interface LEDs (-i). Interfaces matching a pattern are watched while they exist: the kernel's
+ *  hot-plug events open and close their packet counter files, so a tick only reads the open ones */
+struct interface_mapping
+{
+    char               pattern[IFNAMSIZ];
+    unsigned int       pin;
+};
+
+struct watched_interface
+{
+    char               name[IFNAMSIZ];
+    int                rx_packets_fd;
+    int                tx_packets_fd;
+    unsigned int       pin;
+    bool               primed;             /* Has a previous packet count to compare with */
+    unsigned long long packets;
+};
+
+static struct interface_mapping Interface_Mappings[MAX_INTERFACE_MAPPINGS];
+static unsigned int             Interface_Mapping_Count = 0;
+static struct watched_interface Watched_Interfaces[MAX_WATCHED_INTERFACES];
+static unsigned int             Watched_Interface_Count = 0;
+static int                      Uevent_Fd               = -1;
+
+
+static int OpenInterfaceCounter( const char* name, const char* counter )
+{
+    char counter_file_name[sizeof(NET_CLASS_DIRECTORY) + IFNAMSIZ + sizeof(NET_STATISTICS_DIRECTORY) + 16];
+
+    snprintf( counter_file_name, sizeof(counter_file_name), NET_CLASS_DIRECTORY "/%s/" NET_STATISTICS_DIRECTORY "/%s", name, counter );
+
+    return open( counter_file_name, O_RDONLY | O_CLOEXEC );
+}
+
+
+/* Start watching an interface, if it matches one of the patterns */
+static void WatchInterface( const char* name )
+{
+    struct watched_interface* watched;
+    unsigned int              mapping;
+
+    if( (strlen(name) >= IFNAMSIZ) || (Watched_Interface_Count == MAX_WATCHED_INTERFACES) )
+        return;
+
+    for( unsigned int index = 0; index < Watched_Interface_Count; index++ )
+    {
+        if( strcmp(Watched_Interfaces[index].name, name) == 0 )
+            return;
+    }
+
+    for( mapping = 0; mapping < Interface_Mapping_Count; mapping++ )
+    {
+        if( fnmatch(Interface_Mappings[mapping].pattern, name, 0) == 0 )
+            break;
+    }
+
+    if( mapping == Interface_Mapping_Count )
+        return;
+
+    watched                = &Watched_Interfaces[Watched_Interface_Count];
+    watched->rx_packets_fd = OpenInterfaceCounter( name, NET_RX_PACKETS_FILE_NAME );
+    watched->tx_packets_fd = OpenInterfaceCounter( name, NET_TX_PACKETS_FILE_NAME );
+    if( (watched->rx_packets_fd < 0) || (watched->tx_packets_fd < 0) )
+    {
+        if( watched->rx_packets_fd >= 0 )
+            close( watched->rx_packets_fd );
+        if( watched->tx_packets_fd >= 0 )
+            close( watched->tx_packets_fd );
+        return;
+    }
+
+    strcpy( watched->name, name );
+    watched->pin    = Interface_Mappings[mapping].pin;
+    watched->primed = false;
+    Watched_Interface_Count++;
+}
+
+
+static void UnwatchInterface( const char* name )
+{
+    for( unsigned int index = 0; index < Watched_Interface_Count; index++ )
+    {
+        if( strcmp(Watched_Interfaces[index].name, name) == 0 )
+        {
+            close( Watched_Interfaces[index].rx_packets_fd );
+            close( Watched_Interfaces[index].tx_packets_fd );
+            Watched_Interfaces[index] = Watched_Interfaces[--Watched_Interface_Count];
+            return;
+        }
+    }
+}
+
+
+/* Watch every matching interface present now; only at startup, and if hot-plug events were lost */
+static void ScanNetInterfaces( void )
+{
+    DIR*           directory = opendir( NET_CLASS_DIRECTORY );
+    struct dirent* entry;
+
+    if( directory == NULL )
+        return;
+
+    while( (entry = readdir(directory)) != NULL )
+    {
+        if( entry->d_name[0] != '.' )
+            WatchInterface( entry->d_name );
+    }
+
+    closedir( directory );
+}
+
+
+/* Apply the queued hot-plug events for network interfaces */
+static int HandleUevents( int uevent_fd )
+{
+    static char   buffer[UEVENT_BUFFER_SIZE];
+    struct uevent event;
+    int           result;
+
+    while( (result = UeventRead(uevent_fd, buffer, sizeof(buffer), &event)) != 0 )
+    {
+        if( result < 0 )
+        {
+            if( errno != ENOBUFS )
+                return -1;
+
+            ScanNetInterfaces();
+            continue;
+        }
+
+        if( (event.action == NULL) || (event.name == NULL) || (event.subsystem == NULL) || (strcmp(event.subsystem, UEVENT_SUBSYSTEM_NET) != 0) )
+            continue;
+
+        if( strcmp(event.action, UEVENT_ACTION_ADD) == 0 )
+        {
+            WatchInterface( event.name );
+        }
+        else if( strcmp(event.action, UEVENT_ACTION_REMOVE) == 0 )
+        {
+            UnwatchInterface( event.name );
+        }
+        else if( strcmp(event.action, UEVENT_ACTION_MOVE) == 0 )
+        {
+            /* Renamed, e.g. eth1 to enx001122334455 by udev */
+            if( event.old_name != NULL )
+                UnwatchInterface( event.old_name );
+            WatchInterface( event.name );
+        }
+    }
+
+    return 0;
+}
+
+
+/* Read one decimal counter from an open sysfs attribute; false if the device has gone */
+static bool ReadCounterFile( int counter_fd, unsigned long long* p_value )
+{
+    char               counter_buffer[NET_COUNTER_BUFFER_SIZE];
+    unsigned long long value  = 0;
+    ssize_t            length = TEMP_FAILURE_RETRY( pread(counter_fd, counter_buffer, sizeof(counter_buffer), 0) );
+
+    if( length <= 0 )
+        return false;
+
+    for( ssize_t index = 0; (index < length) && (counter_buffer[index] >= '0') && (counter_buffer[index] <= '9'); index++ )
+        value = (value * 10) + (counter_buffer[index] - '0');
+
+    *p_value = value;
+
+    return true;
+}
+
+
+/* Compare each watched interface's packet counts with the last poll. Nothing is allocated */
+static void InterfaceActivity( void )
+{
+    /* Last to first: UnwatchInterface() fills the gap with the table's last entry, which is then already done */
+    for( unsigned int index = Watched_Interface_Count; index-- > 0; )
+    {
+        struct watched_interface* watched = &Watched_Interfaces[index];
+        unsigned long long        rx_packets;
+        unsigned long long        tx_packets;
+
+        /* Gone, and the remove event not seen yet */
+        if( (ReadCounterFile(watched->rx_packets_fd, &rx_packets) == false) || (ReadCounterFile(watched->tx_packets_fd, &tx_packets) == false) )
+        {
+            UnwatchInterface( watched->name );
+            continue;
+        }
+
+        if( (watched->primed == true) && ((rx_packets + tx_packets) != watched->packets) )
+            LedsRequest( watched->pin, LED_LEVEL_FULL );
+
+        watched->packets = rx_packets + tx_packets;
+        watched->primed  = true;
+    }
+}
+
+
+/* Parse a "PATTERN@PIN" interface mapping */
+static bool ParseInterfaceMapping( const char* spec )
+{
+    const char* at_sign = strrchr( spec, '@' );
+    char*       end;
+    long        pin;
+
+    if( (at_sign == NULL) || (at_sign == spec) || ((size_t)(at_sign - spec) >= IFNAMSIZ) || (Interface_Mapping_Count == MAX_INTERFACE_MAPPINGS) )
+        return false;
+
+    pin = strtol( at_sign + 1, &end, NUMERIC_OPTION_BASE );
+    if( (end == at_sign + 1) || (*end != '\0') || (pin < MIN_VALID_MAP_PIN) || (pin > MAX_VALID_MAP_PIN) )
+        return false;
+
+    memcpy( Interface_Mappings[Interface_Mapping_Count].pattern, spec, at_sign - spec );
+    Interface_Mappings[Interface_Mapping_Count].pattern[at_sign - spec] = '\0';
+    Interface_Mappings[Interface_Mapping_Count].pin                     = pin;
+    Interface_Mapping_Count++;
+
+    return true;
+}
+
+
+/* Other network namespaces (-n). A helper thread joins each namespace once and opens its /proc/net/dev
+ *  there; the open file keeps showing that namespace's interfaces, so a tick is one pread per namespace */
+struct network_namespace
+{
+    char*              path;
+    bool               has_pin;            /* false: added to the receive and transmit LEDs */
+    unsigned int       pin;
+    int                stats_fd;
+    int                open_error;         /* errno from the helper thread */
+    bool               primed;
+    unsigned long long rx_packets;
+    unsigned long long tx_packets;
+};
+
+static struct network_namespace Namespaces[MAX_NAMESPACES];
+static unsigned int             Namespace_Count = 0;
+static char*                    Namespace_Stats_Buffer      = NULL;  /* Shared by the namespaces; grows to fit the longest file */
+static size_t                   Namespace_Stats_Buffer_Size = 0;
+
+
+/* Helper thread: setns() only moves the calling thread, so the daemon's own threads stay where they are */
+static void* OpenNamespaceStats( void* arg )
+{
+    struct network_namespace* namespace = arg;
+    int                       namespace_fd = open( namespace->path, O_RDONLY | O_CLOEXEC );
+
+    if( namespace_fd < 0 )
+    {
+        namespace->open_error = errno;
+        return NULL;
+    }
+
+    if( setns(namespace_fd, CLONE_NEWNET) == 0 )
+    {
+        namespace->stats_fd = open( NAMESPACE_STATS_FILE_NAME, O_RDONLY | O_CLOEXEC );
+        if( namespace->stats_fd < 0 )
+            namespace->open_error = errno;
+    }
+    else
+    {
+        namespace->open_error = errno;
+    }
+
+    close( namespace_fd );
+
+    return NULL;
+}
+
+
+static int OpenNamespaces( void )
+{
+    for( unsigned int index = 0; index < Namespace_Count; index++ )
+    {
+        pthread_t helper;
+        int       result = pthread_create( &helper, NULL, OpenNamespaceStats, &Namespaces[index] );
+
+        if( result == 0 )
+            result = pthread_join( helper, NULL );
+
+        if( (result == 0) && (Namespaces[index].stats_fd < 0) )
+            result = Namespaces[index].open_error;
+
+        if( result != 0 )
+        {
+            errno = result;
+            perror( Namespaces[index].path );
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+static void CloseNamespaces( void )
+{
+    for( unsigned int index = 0; index < Namespace_Count; index++ )
+    {
+        if( Namespaces[index].stats_fd >= 0 )
+            close( Namespaces[index].stats_fd );
+        Namespaces[index].stats_fd = -1;
+
+        free( Namespaces[index].path );
+        Namespaces[index].path = NULL;
+    }
+
+    free( Namespace_Stats_Buffer );
+    Namespace_Stats_Buffer      = NULL;
+    Namespace_Stats_Buffer_Size = 0;
+}
+
+
+/* Read a namespace's /proc/net/dev to the end; one read may stop short of it with many interfaces.
+ *  The buffer only grows while the file does, so normally a tick allocates nothing */
+static ssize_t ReadNamespaceStats( int stats_fd )
+{
+    size_t length = 0;
+
+    for( ;; )
+    {
+        ssize_t read_length;
+
+        if( length == Namespace_Stats_Buffer_Size )
+        {
+            size_t new_size   = (Namespace_Stats_Buffer_Size == 0) ? NAMESPACE_STATS_BUFFER_SIZE : (2 * Namespace_Stats_Buffer_Size);
+            char*  new_buffer = realloc( Namespace_Stats_Buffer, new_size );
+
+            if( new_buffer == NULL )
+                return -1;
+
+            Namespace_Stats_Buffer      = new_buffer;
+            Namespace_Stats_Buffer_Size = new_size;
+        }
+
+        read_length = TEMP_FAILURE_RETRY( pread(stats_fd, Namespace_Stats_Buffer + length, Namespace_Stats_Buffer_Size - length, length) );
+        if( read_length < 0 )
+            return -1;
+        if( read_length == 0 )
+            return length;
+
+        length += read_length;
+    }
+}
+
+
+/* Sum the packet counts of every interface but loopback in an image of /proc/net/dev, without allocating */
+static void SumNetDevPackets( const char* text, const char* end, unsigned long long* p_rx_packets, unsigned long long* p_tx_packets )
+{
+    *p_rx_packets = 0;
+    *p_tx_packets = 0;
+
+    while( text < end )
+    {
+        const char*  line_end = memchr( text, '\n', end - text );
+        const char*  colon;
+        const char*  name;
+        unsigned int field    = 0;
+
+        if( line_end == NULL )
+            line_end = end;
+
+        /* The two header lines have no colon */
+        colon = memchr( text, ':', line_end - text );
+        if( colon == NULL )
+        {
+            text = line_end + 1;
+            continue;
+        }
+
+        for( name = text; (name < colon) && (*name == ' '); name++ )
+            ;
+
+        if( ((size_t)(colon - name) == strlen(NET_LOOPBACK_INTERFACE_NAME)) && (memcmp(name, NET_LOOPBACK_INTERFACE_NAME, colon - name) == 0) )
+        {
+            text = line_end + 1;
+            continue;
+        }
+
+        /* Same columns as in Activity(): rx packets is the second number, tx packets the tenth */
+        for( text = colon + 1; (text < line_end) && (field <= NET_DEV_TX_PACKETS_FIELD); field++ )
+        {
+            unsigned long long value = 0;
+
+            while( (text < line_end) && (*text == ' ') )
+                text++;
+
+            while( (text < line_end) && (*text >= '0') && (*text <= '9') )
+                value = (value * 10) + (*text++ - '0');
+
+            if( field == NET_DEV_RX_PACKETS_FIELD )
+                *p_rx_packets += value;
+            else if( field == NET_DEV_TX_PACKETS_FIELD )
+                *p_tx_packets += value;
+        }
+
+        text = line_end + 1;
+    }
+}
+
+
+/* Read every namespace's statistics. The packets of namespaces without their own LED are added to the totals */
+static int NamespaceActivity( bool* p_txAct, bool* p_rxAct, unsigned long long* p_tx_packets, unsigned long long* p_rx_packets )
+{
+    for( unsigned int index = 0; index < Namespace_Count; index++ )
+    {
+        struct network_namespace* namespace = &Namespaces[index];
+        unsigned long long        rx_packets;
+        unsigned long long        tx_packets;
+        ssize_t                   length    = ReadNamespaceStats( namespace->stats_fd );
+
+        if( length < 0 )
+        {
+            perror( namespace->path );
+            return -1;
+        }
+
+        SumNetDevPackets( Namespace_Stats_Buffer, Namespace_Stats_Buffer + length, &rx_packets, &tx_packets );
+
+        if( namespace->primed == true )
+        {
+            /* Counts that went down (an interface removed there) are not traffic */
+            unsigned long long rx_delta = (rx_packets > namespace->rx_packets) ? (rx_packets - namespace->rx_packets) : 0;
+            unsigned long long tx_delta = (tx_packets > namespace->tx_packets) ? (tx_packets - namespace->tx_packets) : 0;
+
+            if( namespace->has_pin == true )
+            {
+                if( (rx_delta + tx_delta) > 0 )
+                    LedsRequest( namespace->pin, LED_LEVEL_FULL );
+            }
+            else
+            {
+                *p_rxAct       = (*p_rxAct == true) || (rx_delta > 0);
+                *p_txAct       = (*p_txAct == true) || (tx_delta > 0);
+                *p_rx_packets += rx_delta;
+                *p_tx_packets += tx_delta;
+            }
+        }
+
+        namespace->rx_packets = rx_packets;
+        namespace->tx_packets = tx_packets;
+        namespace->primed     = true;
+    }
+
+    return 0;
+}
+
+
+/* Parse "NSPATH" or "NSPATH@PIN" */
+static bool ParseNamespace( const char* spec )
+{
+    struct network_namespace* namespace = &Namespaces[Namespace_Count];
+    const char*               at_sign   = strrchr( spec, '@' );
+    char*                     path;
+
+    if( (Namespace_Count == MAX_NAMESPACES) || (*spec == '\0') )
+        return false;
+
+    path = strdup( spec );
+    if( path == NULL )
+        return false;
+
+    memset( namespace, 0, sizeof(*namespace) );
+    namespace->path     = path;
+    namespace->stats_fd = -1;
+
+    if( (at_sign != NULL) && (at_sign != spec) )
+    {
+        char* end;
+        long  pin = strtol( at_sign + 1, &end, NUMERIC_OPTION_BASE );
+
+        if( (end == at_sign + 1) || (*end != '\0') || (pin < MIN_VALID_MAP_PIN) || (pin > MAX_VALID_MAP_PIN) )
+        {
+            free( path );
+            namespace->path = NULL;
+            return false;
+        }
+
+        path[at_sign - spec] = '\0';
+        namespace->has_pin   = true;
+        namespace->pin       = pin;
+    }
+
+    Namespace_Count++;
+
+    return true;
+}
 
-#include "macroasstring.h"
-#include "pinetleds.h"
-#include "pinetledsstrings.h"
 
-#define VERSION_MAJOR                     0
-#define VERSION_MINOR                     1
+/* Memory-mapped TPACKET_V3 receive ring */
+struct packet_ring
+{
+    int                socket_fd;
+    unsigned char*     map;
+    size_t             map_size;
+    unsigned int       block_size;
+    unsigned int       block_count;
+    unsigned int       next_block;
+    unsigned int       ifindex;            /* 0: all interfaces */
+};
 
-/* Version string for GLIBC's argp helper functions */
-const char*          argp_program_version      = "PiNetLeds v" MACRO_VALUE_AS_STRING(VERSION_MAJOR) "." MACRO_VALUE_AS_STRING(VERSION_MINOR);
 
-static unsigned int  Option_Poll_Interval_Time = DEFAULT_POLL_TIME_MILLISECONDS;
-static unsigned int  Option_Tx_Led_GPIO_Pin    = DEFAULT_TX_LED_GPIO_PIN;        /* wiringPi numbering scheme */
-static unsigned int  Option_Rx_Led_GPIO_Pin    = DEFAULT_RX_LED_GPIO_PIN;        /* wiringPi numbering scheme */
-static bool          Option_Detach             = false;
+void ClosePacketRing( struct packet_ring* ring )
+{
+    if( (ring->map != NULL) && (ring->map != MAP_FAILED) )
+        munmap( ring->map, ring->map_size );
 
-static volatile bool Keep_Running              = true;
+    if( ring->socket_fd >= 0 )
+        close( ring->socket_fd );
+
+    ring->map       = MAP_FAILED;
+    ring->socket_fd = -1;
+}
 
 
-/* Reread the network statistics file */
-int Activity( FILE* netstatsfile, bool* p_txAct, bool* p_rxAct )
+/* Set up an AF_PACKET socket with a TPACKET_V3 ring, capturing only a few header bytes of each packet */
+int OpenPacketRing( const char* interface_name, struct packet_ring* ring )
 {
-        static unsigned int prev_total_rx_packets         = 0;
-        static unsigned int prev_total_tx_packets         = 0;
+    int                 version       = TPACKET_V3;
+    unsigned int        ifindex       = 0;
+    unsigned int        loopback      = 0;
+    struct tpacket_req3 request;
+    struct sockaddr_ll  address;
+    struct sock_fprog   program;
 
-        unsigned int        cur_total_rx_packets          = 0;
-        unsigned int        cur_total_tx_packets          = 0;
-        char*               netstatsfile_line_buffer      = NULL; // Let getline() worry about the line length
-        size_t              netstatsfile_line_buffer_size = 0;
+    /* Drop loopback traffic (unless a single interface was asked for), keep a few bytes of everything else */
+    struct sock_filter  filter[]      =
+    {
+        BPF_STMT( BPF_LD  | BPF_W   | BPF_ABS, SKF_AD_OFF + SKF_AD_IFINDEX ),
+        BPF_JUMP( BPF_JMP | BPF_JEQ | BPF_K,   0, 0, 1 ),
+        BPF_STMT( BPF_RET | BPF_K,             0 ),
+        BPF_STMT( BPF_RET | BPF_K,             PACKET_RING_SNAPLEN ),
+    };
 
-        int                 result;
- 
-        /* Go to the beginning of the network statistics file */
-        result = TEMP_FAILURE_RETRY( fseek(netstatsfile, 0L, SEEK_SET) );
-        if( result != 0 )
-        {
-            perror( NETWORK_STATS_FILE_SEEK_ERROR_MSG );
-            return result;
-        }
+    memset( ring, 0, sizeof(*ring) );
+    ring->socket_fd = -1;
+    ring->map       = MAP_FAILED;
 
-        /* Clear glibc's buffer */
-        result = TEMP_FAILURE_RETRY( fflush(netstatsfile) );
-        if( result != 0 )
+    if( interface_name != NULL )
+    {
+        ifindex = if_nametoindex( interface_name );
+        if( ifindex == 0 )
         {
-            perror( FILE_BUFFER_FLUSH_ERROR_MSG );
-            return result;
+            fprintf( stderr, "%s: %s\n", interface_name, UNKNOWN_INTERFACE_ERROR_MSG );
+            return -1;
         }
+    }
+    else
+    {
+        loopback = if_nametoindex( NET_LOOPBACK_INTERFACE_NAME );
+    }
 
-        /* Extract the I/O stats */
-        while( (getline(&netstatsfile_line_buffer, &netstatsfile_line_buffer_size, netstatsfile) != -1) && (errno != EINTR) )
-        {
-            unsigned int this_dev_rx_packets             = 0;
-            unsigned int this_dev_tx_packets             = 0;
-            bool         use_packet_counts_from_this_dev = false;
-            char*        dev_name_buffer                 = NULL; // Let sscanf() worry about the length of the device name (use "%ms")
+    /* A loopback index of 0 never matches, so nothing is dropped */
+    filter[1].k     = loopback;
+    program.len     = sizeof(filter) / sizeof(filter[0]);
+    program.filter  = filter;
 
-            /* The format of the network statistics file is assumed to be one line per network device, each of which contains the following (@=to be ignored):
-             *  Network interface name,
-             *  @rx bytes, rx packets, @rx errs, @rx drop, @rx fifo, @rx frame, @rx compressed, @rx multicast,
-             *  @tx bytes, tx packets, @tx errs, @tx drop, @tx fifo, @tx colls, @tx carrier, @tx compressed
-             */
-            if( sscanf(netstatsfile_line_buffer, "%ms %*u %u %*u %*u %*u %*u %*u %*u %*u %u %*u %*u %*u %*u %*u %*u", &dev_name_buffer, &this_dev_rx_packets, &this_dev_tx_packets) != 0 )
-            {
-                use_packet_counts_from_this_dev = (strstr(dev_name_buffer, DEFAULT_NET_LOOPBACK_DEVICE_NAME) == NULL); // Skip the "loopback" device
+    /* Protocol 0 receives nothing until the bind() below, after the filter and ring are in place */
+    ring->socket_fd = socket( AF_PACKET, SOCK_RAW | SOCK_CLOEXEC, 0 );
+    if( ring->socket_fd < 0 )
+        goto error;
 
-                if( use_packet_counts_from_this_dev == true )
-                {
-                    cur_total_rx_packets += this_dev_rx_packets;
-                    cur_total_tx_packets += this_dev_tx_packets;
-                }
-            }
+    if( setsockopt(ring->socket_fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) != 0 )
+        goto error;
 
-            if( dev_name_buffer != NULL )
-                free( dev_name_buffer );
-        }
+    if( setsockopt(ring->socket_fd, SOL_SOCKET, SO_ATTACH_FILTER, &program, sizeof(program)) != 0 )
+        goto error;
+
+    memset( &request, 0, sizeof(request) );
+    ring->block_size             = getpagesize();
+    ring->block_count            = PACKET_RING_BLOCK_COUNT;
+    request.tp_block_size        = ring->block_size;
+    request.tp_block_nr          = ring->block_count;
+    request.tp_frame_size        = PACKET_RING_FRAME_SIZE;
+    request.tp_frame_nr          = (ring->block_size / PACKET_RING_FRAME_SIZE) * ring->block_count;
+    request.tp_retire_blk_tov    = Option_Capture_Latency;
+    request.tp_feature_req_word  = 0;
+
+    if( setsockopt(ring->socket_fd, SOL_PACKET, PACKET_RX_RING, &request, sizeof(request)) != 0 )
+        goto error;
+
+    ring->map_size = (size_t)ring->block_size * ring->block_count;
+    ring->map      = mmap( NULL, ring->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, ring->socket_fd, 0 );
+    if( ring->map == MAP_FAILED )
+        goto error;
+
+    memset( &address, 0, sizeof(address) );
+    address.sll_family   = AF_PACKET;
+    address.sll_protocol = htons( ETH_P_ALL );
+    address.sll_ifindex  = ifindex;
+
+    if( bind(ring->socket_fd, (struct sockaddr*)&address, sizeof(address)) != 0 )
+        goto error;
+
+    ring->ifindex = ifindex;
+
+    return 0;
+
+error:
+    perror( PACKET_RING_OPEN_ERROR_MSG );
+    ClosePacketRing( ring );
 
-        /* Anything changed? */
-        if( (*p_txAct = (prev_total_tx_packets != cur_total_tx_packets)) == true )
+    return -1;
+}
+
+
+/* Count the packets in every block the kernel has handed over, then give the blocks back. No packet data is copied */
+void ReadPacketRing( struct packet_ring* ring, unsigned int* p_rx_packets, unsigned int* p_tx_packets )
+{
+    for( ;; )
+    {
+        struct tpacket_block_desc* block = (struct tpacket_block_desc*)(ring->map + ((size_t)ring->next_block * ring->block_size));
+        struct tpacket3_hdr*       packet;
+        unsigned int               packet_count;
+
+        if( (__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0 )
+            break;
+
+        packet       = (struct tpacket3_hdr*)((unsigned char*)block + block->hdr.bh1.offset_to_first_pkt);
+        packet_count = block->hdr.bh1.num_pkts;
+
+        while( packet_count-- > 0 )
         {
-            prev_total_tx_packets = cur_total_tx_packets;
+            const struct sockaddr_ll* link = (const struct sockaddr_ll*)((unsigned char*)packet + TPACKET_ALIGN(sizeof(struct tpacket3_hdr)));
+
+            if( link->sll_pkttype == PACKET_OUTGOING )
+                (*p_tx_packets)++;
+            else
+                (*p_rx_packets)++;
+
+            packet = (struct tpacket3_hdr*)((unsigned char*)packet + packet->tp_next_offset);
         }
 
-        if( (*p_rxAct = (prev_total_rx_packets != cur_total_rx_packets)) == true )
+        __atomic_store_n( &block->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE );
+        ring->next_block = (ring->next_block + 1) % ring->block_count;
+    }
+}
+
+
+static unsigned long long NanosecondsBetween( const struct timespec* start, const struct timespec* end )
+{
+    return ((end->tv_sec - start->tv_sec) * NANOSECONDS_PER_SECOND) + end->tv_nsec - start->tv_nsec;
+}
+
+
+/* Count packets towards the bar graph; once a poll interval has gone by, show their rate */
+static int BarGraphPackets( unsigned long long packets, const struct timespec* now )
+{
+    static struct timespec    window_start;
+    static unsigned long long window_packets = 0;
+    static bool               started        = false;
+
+    unsigned long long        elapsed;
+
+    /* After a quiet spell, start a fresh window rather than averaging the first packets over it */
+    if( (started == false) || ((window_packets == 0) && (NanosecondsBetween(&window_start, now) > (2 * Option_Poll_Interval_Time * 1000000ULL))) )
+    {
+        window_start = *now;
+        started      = true;
+    }
+
+    window_packets += packets;
+
+    elapsed = NanosecondsBetween( &window_start, now );
+    if( elapsed < (Option_Poll_Interval_Time * 1000000ULL) )
+        return 0;
+
+    packets        = (window_packets * NANOSECONDS_PER_SECOND) / elapsed;
+    window_start   = *now;
+    window_packets = 0;
+
+    return ShiftRegisterUpdate( &Option_Bar_Graph.output, BarGraphFrame(&Option_Bar_Graph, packets) );
+}
+
+
+/* Milliseconds from now until the deadline, rounded up; 0 if already passed */
+static int MillisecondsUntil( const struct timespec* now, const struct timespec* deadline )
+{
+    long long seconds     = deadline->tv_sec - now->tv_sec;
+    long long nanoseconds = deadline->tv_nsec - now->tv_nsec;
+    long long milliseconds;
+
+    if( nanoseconds < 0 )
+    {
+        seconds--;
+        nanoseconds += NANOSECONDS_PER_SECOND;
+    }
+
+    if( seconds < 0 )
+        return 0;
+
+    milliseconds = (seconds * 1000LL) + ((nanoseconds + 999999) / 1000000);
+
+    return (milliseconds < INT_MAX) ? (int)milliseconds : INT_MAX;
+}
+
+
+/* The time one poll interval from now */
+static void LedOffDeadline( const struct timespec* now, struct timespec* deadline )
+{
+    deadline->tv_sec  = now->tv_sec + (Option_Poll_Interval_Time / 1000);
+    deadline->tv_nsec = now->tv_nsec + (1000000 * (Option_Poll_Interval_Time % 1000));
+
+    if( deadline->tv_nsec >= 1000000000 )
+    {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000;
+    }
+}
+
+
+/* Record the receive and transmit rates seen over one poll, then write out the rate report if its interval is over */
+static int RecordPollRates( unsigned long long rx_packets, unsigned long long tx_packets, unsigned long long elapsed_nanoseconds, const struct timespec* now )
+{
+    if( elapsed_nanoseconds > 0 )
+    {
+        RateHistogramRecord( &Rate_Report.sources[RATE_REPORT_RX_SOURCE], (rx_packets * NANOSECONDS_PER_SECOND) / elapsed_nanoseconds );
+        RateHistogramRecord( &Rate_Report.sources[RATE_REPORT_TX_SOURCE], (tx_packets * NANOSECONDS_PER_SECOND) / elapsed_nanoseconds );
+    }
+
+    return RateReportTick( &Rate_Report, now );
+}
+
+
+/* The capture ring has no polls, so its packets are counted in windows of one poll interval. The packets
+ *  seen when the ring wakes us go into the last whole window gone by; any windows before it were quiet */
+static int RecordRingRates( unsigned int rx_packets, unsigned int tx_packets, const struct timespec* now )
+{
+    static struct timespec    window_start;
+    static unsigned long long window_rx_packets = 0;
+    static unsigned long long window_tx_packets = 0;
+    static bool               started           = false;
+
+    unsigned long long        window_nanoseconds = Option_Poll_Interval_Time * 1000000ULL;
+    unsigned long long        windows;
+
+    /* No rotation can have happened before the first call, so the report interval started with the first window */
+    if( started == false )
+    {
+        window_start = Rate_Report.interval_start;
+        started      = true;
+    }
+
+    window_rx_packets += rx_packets;
+    window_tx_packets += tx_packets;
+
+    windows = NanosecondsBetween( &window_start, now ) / window_nanoseconds;
+    if( windows > 0 )
+    {
+        unsigned long long advance = windows * window_nanoseconds;
+
+        RateHistogramRecord( &Rate_Report.sources[RATE_REPORT_RX_SOURCE], (window_rx_packets * 1000) / Option_Poll_Interval_Time );
+        RateHistogramRecord( &Rate_Report.sources[RATE_REPORT_TX_SOURCE], (window_tx_packets * 1000) / Option_Poll_Interval_Time );
+        RateReportRecordQuiet( &Rate_Report, advance - window_nanoseconds, window_nanoseconds );
+
+        window_start.tv_sec  += advance / NANOSECONDS_PER_SECOND;
+        window_start.tv_nsec += advance % NANOSECONDS_PER_SECOND;
+        if( window_start.tv_nsec >= (long)NANOSECONDS_PER_SECOND )
         {
-            prev_total_rx_packets = cur_total_rx_packets;
+            window_start.tv_sec++;
+            window_start.tv_nsec -= NANOSECONDS_PER_SECOND;
         }
 
-        if( netstatsfile_line_buffer != NULL )
-            free( netstatsfile_line_buffer );
+        window_rx_packets = 0;
+        window_tx_packets = 0;
+    }
 
-        return result;
+    return RateReportTick( &Rate_Report, now );
 }
 
 
-/* Update the LEDs */
-void LedsOn( bool want_txAct_on, bool want_rxAct_on )
+/* Clear the error the kernel reports on the ring's socket when the captured interface goes down. The
+ *  socket picks up again by itself when the interface comes back up, but not if it was removed: then
+ *  the ring is closed, and reopened once an interface of that name exists again */
+static void HandlePacketRingError( struct packet_ring* ring )
 {
-        static bool txAct_on = true; /* Ensure the LEDs turn off on first call */
-        static bool rxAct_on = true;
+    int       error  = 0;
+    socklen_t length = sizeof(error);
 
-        if( (want_txAct_on == txAct_on) && (want_rxAct_on == rxAct_on) )
-                return;
+    getsockopt( ring->socket_fd, SOL_SOCKET, SO_ERROR, &error, &length );
+
+    if( (ring->ifindex != 0) && (if_nametoindex(Option_Capture_Interface) != ring->ifindex) )
+        ClosePacketRing( ring );
+}
+
+
+/* Light an LED as soon as a packet shows up in the ring, and put it out again one poll interval after the last one */
+int PacketRingLoop( struct packet_ring* ring )
+{
+    bool            tx_lit = false;
+    bool            rx_lit = false;
+    struct timespec tx_off = { 0, 0 };
+    struct timespec rx_off = { 0, 0 };
+
+    while( Keep_Running == true )
+    {
+        struct pollfd   ring_poll   = { ring->socket_fd, POLLIN | POLLERR, 0 };
+        unsigned int    rx_packets  = 0;
+        unsigned int    tx_packets  = 0;
+        int             timeout     = -1;
+        struct timespec now;
+
+        /* Sleep until a block is retired, or until a lit LED is due to go out */
+        clock_gettime( CLOCK_MONOTONIC, &now );
+        if( tx_lit == true )
+            timeout = MillisecondsUntil( &now, &tx_off );
+        if( (rx_lit == true) && ((timeout < 0) || (MillisecondsUntil(&now, &rx_off) < timeout)) )
+            timeout = MillisecondsUntil( &now, &rx_off );
+
+        /* A lit bar graph has to be brought down again even if no more packets come */
+        if( (Option_Use_Bar_Graph == true) && (Option_Bar_Graph.output.frame != 0) && ((timeout < 0) || (timeout > (int)Option_Poll_Interval_Time)) )
+            timeout = Option_Poll_Interval_Time;
 
-        if( want_txAct_on || ((Option_Tx_Led_GPIO_Pin == Option_Rx_Led_GPIO_Pin) && want_rxAct_on) )
+        /* The rate report is written on time, even if no more packets come */
+        if( (Rate_Report.output != NULL) && ((timeout < 0) || (MillisecondsUntil(&now, &Rate_Report.rotate_at) < timeout)) )
+            timeout = MillisecondsUntil( &now, &Rate_Report.rotate_at );
+
+        /* Without a ring (poll() skips the closed socket), look for the interface again now and then */
+        if( (ring->socket_fd < 0) && ((timeout < 0) || (timeout > PACKET_RING_REOPEN_MILLISECONDS)) )
+            timeout = PACKET_RING_REOPEN_MILLISECONDS;
+
+        if( poll(&ring_poll, 1, timeout) < 0 )
         {
-            digitalWrite( Option_Tx_Led_GPIO_Pin, HIGH );
-            txAct_on = true;
+            if( errno == EINTR )
+                continue;
+
+            perror( PACKET_RING_POLL_ERROR_MSG );
+            return -1;
         }
-        else
+
+        if( (ring_poll.revents & POLLERR) != 0 )
+            HandlePacketRingError( ring );
+
+        if( ring->socket_fd >= 0 )
+        {
+            ReadPacketRing( ring, &rx_packets, &tx_packets );
+        }
+        else if( (if_nametoindex(Option_Capture_Interface) != 0) && (OpenPacketRing(Option_Capture_Interface, ring) != 0) )
         {
-            digitalWrite( Option_Tx_Led_GPIO_Pin, LOW );
-            txAct_on = false;
+            return -1;
         }
 
-        if( want_rxAct_on || ((Option_Rx_Led_GPIO_Pin == Option_Tx_Led_GPIO_Pin) && want_txAct_on) )
+        clock_gettime( CLOCK_MONOTONIC, &now );
+
+        if( tx_packets > 0 )
         {
-            digitalWrite( Option_Rx_Led_GPIO_Pin, HIGH );
-            rxAct_on = true;
+            tx_lit = true;
+            LedOffDeadline( &now, &tx_off );
         }
-        else
+        else if( (tx_lit == true) && (MillisecondsUntil(&now, &tx_off) == 0) )
+        {
+            tx_lit = false;
+        }
+
+        if( rx_packets > 0 )
+        {
+            rx_lit = true;
+            LedOffDeadline( &now, &rx_off );
+        }
+        else if( (rx_lit == true) && (MillisecondsUntil(&now, &rx_off) == 0) )
         {
-            digitalWrite( Option_Rx_Led_GPIO_Pin, LOW );
-            rxAct_on = false;
+            rx_lit = false;
         }
+
+        LedsOn( tx_lit, rx_lit );
+
+        if( (Option_Use_Bar_Graph == true) && (BarGraphPackets(rx_packets + tx_packets, &now) != 0) )
+            return -1;
+
+        if( (Rate_Report.output != NULL) && (RecordRingRates(rx_packets, tx_packets, &now) != 0) )
+            return -1;
+    }
+
+    return 0;
 }
 
 
@@ -209,12 +1331,61 @@ error_t ParseOptions( int key, char* arg, struct argp_state* state )
             Option_Detach = true;
             break;
 
+        case OPTION_SIMULATE_KEY:
+            Option_Waveform_File_Name = arg;
+            break;
+
+        case OPTION_STATS_FILE_KEY:
+            Option_Stats_File_Name = arg;
+            break;
+
+        case OPTION_INTERFACE_KEY:
+            if( ParseInterfaceMapping(arg) == false )
+                argp_failure( state, EXIT_FAILURE, 0, INVALID_INTERFACE_OPTION_MESSAGE );
+            break;
+
+        case OPTION_UEVENT_SOCKET_KEY:
+            Option_Uevent_Socket_Path = arg;
+            break;
+
+        case OPTION_NAMESPACE_KEY:
+            if( ParseNamespace(arg) == false )
+                argp_failure( state, EXIT_FAILURE, 0, INVALID_NAMESPACE_OPTION_MESSAGE );
+            break;
+
         case OPTION_POLL_TIME_KEY:
             Option_Poll_Interval_Time = strtol( arg, NULL, NUMERIC_OPTION_BASE );
             if( Option_Poll_Interval_Time < MIN_POLL_TIME_MILLISECONDS )
                 argp_failure( state, EXIT_FAILURE, 0, INVALID_POLL_TIME_OPTION_MESSAGE );
             break;
 
+        case OPTION_CAPTURE_KEY:
+            Option_Packet_Capture    = true;
+            Option_Capture_Interface = arg;
+            break;
+
+        case OPTION_CAPTURE_LATENCY_KEY:
+            Option_Capture_Latency = strtol( arg, NULL, NUMERIC_OPTION_BASE );
+            if( (Option_Capture_Latency < MIN_CAPTURE_LATENCY_MILLISECONDS) || (Option_Capture_Latency > MAX_CAPTURE_LATENCY_MILLISECONDS) )
+                argp_failure( state, EXIT_FAILURE, 0, INVALID_CAPTURE_LATENCY_MESSAGE );
+            break;
+
+        case OPTION_RATE_REPORT_KEY:
+            Option_Rate_Report_File_Name = arg;
+            break;
+
+        case OPTION_REPORT_INTERVAL_KEY:
+            Option_Rate_Report_Interval = strtol( arg, NULL, NUMERIC_OPTION_BASE );
+            if( (Option_Rate_Report_Interval < RATE_REPORT_MIN_INTERVAL_SECONDS) || (Option_Rate_Report_Interval > RATE_REPORT_MAX_INTERVAL_SECONDS) )
+                argp_failure( state, EXIT_FAILURE, 0, INVALID_REPORT_INTERVAL_MESSAGE );
+            break;
+
+        case OPTION_BAR_GRAPH_KEY:
+            if( BarGraphParse(arg, &Option_Bar_Graph) == false )
+                argp_failure( state, EXIT_FAILURE, 0, INVALID_BAR_GRAPH_OPTION_MESSAGE );
+            Option_Use_Bar_Graph = true;
+            break;
+
         case OPTION_TX_PIN_KEY:
             Option_Tx_Led_GPIO_Pin = strtol( arg, NULL, NUMERIC_OPTION_BASE );
             if( (Option_Tx_Led_GPIO_Pin < MIN_VALID_TX_PIN) || (Option_Tx_Led_GPIO_Pin > MAX_VALID_TX_PIN) )
@@ -244,6 +1415,16 @@ int main( int argc, char **argv )
             { OPTION_POLL_TIME_NAME, OPTION_POLL_TIME_KEY, OPTION_POLL_TIME_ARG_TYPE, 0, OPTION_POLL_TIME_DOCUMENTATION, 0 },
             {    OPTION_RX_PIN_NAME,    OPTION_RX_PIN_KEY,    OPTION_RX_PIN_ARG_TYPE, 0,    OPTION_RX_PIN_DOCUMENTATION, 0 },
             {    OPTION_TX_PIN_NAME,    OPTION_TX_PIN_KEY,    OPTION_TX_PIN_ARG_TYPE, 0,    OPTION_TX_PIN_DOCUMENTATION, 0 },
+            {   OPTION_CAPTURE_NAME,   OPTION_CAPTURE_KEY,   OPTION_CAPTURE_ARG_TYPE, OPTION_ARG_OPTIONAL, OPTION_CAPTURE_DOCUMENTATION, 0 },
+            { OPTION_CAPTURE_LATENCY_NAME, OPTION_CAPTURE_LATENCY_KEY, OPTION_CAPTURE_LATENCY_ARG_TYPE, 0, OPTION_CAPTURE_LATENCY_DOCUMENTATION, 0 },
+            { OPTION_BAR_GRAPH_NAME, OPTION_BAR_GRAPH_KEY, OPTION_BAR_GRAPH_ARG_TYPE, 0, OPTION_BAR_GRAPH_DOCUMENTATION, 0 },
+            { OPTION_RATE_REPORT_NAME, OPTION_RATE_REPORT_KEY, OPTION_RATE_REPORT_ARG_TYPE, 0, OPTION_RATE_REPORT_DOCUMENTATION, 0 },
+            { OPTION_REPORT_INTERVAL_NAME, OPTION_REPORT_INTERVAL_KEY, OPTION_REPORT_INTERVAL_ARG_TYPE, 0, OPTION_REPORT_INTERVAL_DOCUMENTATION, 0 },
+            { OPTION_INTERFACE_NAME, OPTION_INTERFACE_KEY, OPTION_INTERFACE_ARG_TYPE, 0, OPTION_INTERFACE_DOCUMENTATION, 0 },
+            { OPTION_UEVENT_SOCKET_NAME, OPTION_UEVENT_SOCKET_KEY, OPTION_UEVENT_SOCKET_ARG_TYPE, 0, OPTION_UEVENT_SOCKET_DOCUMENTATION, 0 },
+            { OPTION_NAMESPACE_NAME, OPTION_NAMESPACE_KEY, OPTION_NAMESPACE_ARG_TYPE, 0, OPTION_NAMESPACE_DOCUMENTATION, 0 },
+            {  OPTION_SIMULATE_NAME,  OPTION_SIMULATE_KEY,  OPTION_SIMULATE_ARG_TYPE, 0,  OPTION_SIMULATE_DOCUMENTATION, 0 },
+            {OPTION_STATS_FILE_NAME,OPTION_STATS_FILE_KEY,OPTION_STATS_FILE_ARG_TYPE, 0,OPTION_STATS_FILE_DOCUMENTATION, 0 },
             { 0 }
         };
 
@@ -254,12 +1435,18 @@ int main( int argc, char **argv )
                 NULL, NULL, NULL
         };
 
-        int   status          = EXIT_FAILURE;
-        FILE* fp_netstatsfile = NULL;
-        bool  tx_activity     = false;
-        bool  rx_activity     = false;
+        int                status          = EXIT_FAILURE;
+        bool               detached_parent = false;
+        FILE*              fp_netstatsfile = NULL;
+        bool               tx_activity     = false;
+        bool               rx_activity     = false;
+        bool               bar_graph_open  = false;
+        unsigned long long tx_packets      = 0;
+        unsigned long long rx_packets      = 0;
 
-        struct timespec delay;
+        struct packet_ring ring = { .socket_fd = -1, .map = MAP_FAILED };
+        struct timespec    delay;
+        struct timespec    last_poll;
 
         /* Parse the command-line */
         parser.options = options;
@@ -270,22 +1457,76 @@ int main( int argc, char **argv )
         delay.tv_nsec = 1000000 * (Option_Poll_Interval_Time % 1000);
 
         /* Ensure the LEDs are off */
-        wiringPiSetup();
-        pinMode( Option_Rx_Led_GPIO_Pin, OUTPUT );
-        pinMode( Option_Tx_Led_GPIO_Pin, OUTPUT );
-        LedsOn( false, false );
+        if( GpioSetup(Option_Waveform_File_Name) != 0 )
+            goto out;
+        LedsAddPin( Option_Rx_Led_GPIO_Pin, false );
+        LedsAddPin( Option_Tx_Led_GPIO_Pin, false );
 
-        /* Open the network statistics file */
-        fp_netstatsfile = fopen( NETWORK_STATS_FILE_NAME, "r" );
-        if( fp_netstatsfile == NULL )
+        for( unsigned int index = 0; index < Interface_Mapping_Count; index++ )
+            LedsAddPin( Interface_Mappings[index].pin, false );
+
+        for( unsigned int index = 0; index < Namespace_Count; index++ )
         {
-            perror( NETWORK_STATS_FILE_OPEN_ERROR_MSG );
-            goto out;
+            if( Namespaces[index].has_pin == true )
+                LedsAddPin( Namespaces[index].pin, false );
         }
 
-        /* Save the current I/O stat values */
-        if( Activity(fp_netstatsfile, &tx_activity, &rx_activity) != 0 )
-            goto out;
+        /* The bar graph shows the combined receive and transmit packet rate */
+        if( Option_Use_Bar_Graph == true )
+        {
+            if( ShiftRegisterOpen(&Option_Bar_Graph.output) != 0 )
+                goto out;
+            bar_graph_open = true;
+        }
+
+        /* Histograms of the receive and transmit packet rates */
+        if( Option_Rate_Report_File_Name != NULL )
+        {
+            if( RateReportOpen(&Rate_Report, Option_Rate_Report_File_Name, Option_Rate_Report_Interval) != 0 )
+                goto out;
+            RateReportAddSource( &Rate_Report, RATE_REPORT_RX_SOURCE_NAME );
+            RateReportAddSource( &Rate_Report, RATE_REPORT_TX_SOURCE_NAME );
+        }
+
+        if( Option_Packet_Capture == true )
+        {
+            /* Packets are counted straight from the capture ring */
+            if( OpenPacketRing(Option_Capture_Interface, &ring) != 0 )
+                goto out;
+        }
+        else
+        {
+            /* Open the network statistics file */
+            fp_netstatsfile = fopen( Option_Stats_File_Name, "r" );
+            if( fp_netstatsfile == NULL )
+            {
+                perror( Option_Stats_File_Name );
+                goto out;
+            }
+
+            /* Save the current I/O stat values */
+            if( (OpenNamespaces() != 0)
+             || (Activity(fp_netstatsfile, &tx_activity, &rx_activity, &tx_packets, &rx_packets) != 0)
+             || (NamespaceActivity(&tx_activity, &rx_activity, &tx_packets, &rx_packets) != 0) )
+                goto out;
+
+            /* Without rtnetlink we just keep polling, whatever the state of the links. Links in other
+             *  namespaces are not monitored, so with namespaces to watch there is no suspending either;
+             *  nor with a fake statistics file, whose interfaces are not the host's */
+            if( (Namespace_Count == 0) && (strcmp(Option_Stats_File_Name, NETWORK_STATS_FILE_NAME) == 0) )
+                Link_Monitor_Fd = OpenLinkMonitor();
+
+            /* Subscribe to hot-plug events before looking at the interfaces, so none slips through in between */
+            if( Interface_Mapping_Count > 0 )
+            {
+                Uevent_Fd = UeventOpen( Option_Uevent_Socket_Path );
+                if( Uevent_Fd < 0 )
+                    goto out;
+
+                ScanNetInterfaces();
+                InterfaceActivity();
+            }
+        }
 
         /* Detach from terminal? */
         if( Option_Detach == true )
@@ -300,7 +1541,8 @@ int main( int argc, char **argv )
             if( child > 0 )
             {
                 /* I am the parent */
-                status = EXIT_SUCCESS;
+                status          = EXIT_SUCCESS;
+                detached_parent = true;
                 goto out;
             }
         }
@@ -321,30 +1563,140 @@ int main( int argc, char **argv )
             sigaction( SIGTERM, &sig_action, NULL );
         }
 
-        /* Loop until signal received */
+        clock_gettime( CLOCK_MONOTONIC, &last_poll );
+
+        if( Rate_Report.output != NULL )
+            RateReportStart( &Rate_Report, &last_poll );
+
+        if( Option_Packet_Capture == true )
+        {
+            if( PacketRingLoop(&ring) == 0 )
+                status = EXIT_SUCCESS;
+            goto out;
+        }
+
+        /* Loop until signal received. The wait doubles as the wait for link notifications, and
+         *  while no link is up there is nothing to poll, so wait for the notifications alone */
         while( Keep_Running == true )
         {
-            int activity_result;
+            int                activity_result;
+            struct timespec    now;
+            unsigned long long elapsed_nanoseconds;
+
+            if( (Link_Monitor_Fd >= 0) || (Uevent_Fd >= 0) )
+            {
+                struct pollfd wait_fds[2]    = { { Link_Monitor_Fd, POLLIN, 0 }, { Uevent_Fd, POLLIN, 0 } };
+                bool          links_were_up  = (Link_Monitor_Fd < 0) || (Running_Interface_Count > 0);
+                int           timeout        = links_were_up ? (int)Option_Poll_Interval_Time : -1;
+
+                /* Even with no link up, the rate report is written on time */
+                if( (links_were_up == false) && (Rate_Report.output != NULL) )
+                {
+                    clock_gettime( CLOCK_MONOTONIC, &now );
+                    timeout = MillisecondsUntil( &now, &Rate_Report.rotate_at );
+                }
+
+                /* poll() skips whichever of the two sockets is not open */
+                if( poll(wait_fds, 2, timeout) < 0 )
+                    break;
+
+                if( ((wait_fds[0].revents & POLLIN) != 0) && (ReadLinkEvents(Link_Monitor_Fd) != 0) )
+                    break;
+
+                if( ((wait_fds[1].revents & POLLIN) != 0) && (HandleUevents(Uevent_Fd) != 0) )
+                    break;
+
+                /* Nothing was polled while no link was up; the time counts as quiet polls */
+                if( (links_were_up == false) && (Rate_Report.output != NULL) )
+                {
+                    clock_gettime( CLOCK_MONOTONIC, &now );
+                    RateReportRecordQuiet( &Rate_Report, NanosecondsBetween(&last_poll, &now), Option_Poll_Interval_Time * 1000000ULL );
+                    last_poll = now;
+                    if( RateReportTick(&Rate_Report, &now) != 0 )
+                        break;
+                }
 
-            if( nanosleep(&delay, NULL) < 0 )
+                if( (Link_Monitor_Fd >= 0) && (Running_Interface_Count == 0) )
+                {
+                    LedsOn( false, false );
+                    if( (bar_graph_open == true) && (ShiftRegisterUpdate(&Option_Bar_Graph.output, 0) != 0) )
+                        break;
+                    continue;
+                }
+
+                /* Back from suspension: take fresh counts, so a link coming up is not shown as traffic */
+                if( links_were_up == false )
+                {
+                    if( Activity(fp_netstatsfile, &tx_activity, &rx_activity, &tx_packets, &rx_packets) != 0 )
+                        break;
+                    InterfaceActivity();
+                    LedsUpdate();
+                    clock_gettime( CLOCK_MONOTONIC, &last_poll );
+                    continue;
+                }
+            }
+            else if( nanosleep(&delay, NULL) < 0 )
+            {
                 break;
+            }
 
-            activity_result = Activity( fp_netstatsfile, &tx_activity, &rx_activity );
+            activity_result = Activity( fp_netstatsfile, &tx_activity, &rx_activity, &tx_packets, &rx_packets );
 
-            if( activity_result != 0 )
+            if( (activity_result != 0) || (NamespaceActivity(&tx_activity, &rx_activity, &tx_packets, &rx_packets) != 0) )
                 break;
 
+            InterfaceActivity();
             LedsOn( tx_activity, rx_activity );
+
+            clock_gettime( CLOCK_MONOTONIC, &now );
+            elapsed_nanoseconds = NanosecondsBetween( &last_poll, &now );
+            last_poll           = now;
+
+            if( (bar_graph_open == true) && (BarGraphPackets(rx_packets + tx_packets, &now) != 0) )
+                break;
+
+            if( (Rate_Report.output != NULL) && (RecordPollRates(rx_packets, tx_packets, elapsed_nanoseconds, &now) != 0) )
+                break;
         }
 
         status = EXIT_SUCCESS;
 
 out:
         /* Ensure the LEDs are off */
-        LedsOn( false, false );
+        LedsOff();
 
         if( fp_netstatsfile != NULL )
             fclose( fp_netstatsfile );
 
+        ClosePacketRing( &ring );
+
+        /* Only the child may blank the bar graph: its pins or SPI device are shared, and it may be shifting a frame */
+        if( (bar_graph_open == true) && (detached_parent == false) )
+            ShiftRegisterClose( &Option_Bar_Graph.output );
+
+        /* The last, partial, interval still gets its line */
+        {
+            struct timespec now;
+
+            clock_gettime( CLOCK_MONOTONIC, &now );
+            RateReportClose( &Rate_Report, &now );
+        }
+
+        if( Link_Monitor_Fd >= 0 )
+            close( Link_Monitor_Fd );
+
+        while( Watched_Interface_Count > 0 )
+            UnwatchInterface( Watched_Interfaces[0].name );
+
+        CloseNamespaces();
+
+        /* The child goes on reading the injection socket; the parent must not remove it */
+        if( detached_parent == false )
+            UeventClose( Uevent_Fd, Option_Uevent_Socket_Path );
+
+        /* The child records the rest of the waveform; only it writes the file */
+        if( detached_parent == false )
+            GpioFinish();
+
         return status;
 }
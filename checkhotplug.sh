@@ -0,0 +1,129 @@
+#!/bin/sh
+#
+# Test helper: checks that the disk table of PiDiskLeds (-b) and the interface
+#  table of PiNetLeds (-i) follow add, remove and rename (move) events sent
+#  with injectuevent. Runs in a private mount namespace, with empty tmpfs
+#  mounts over /sys/block and /sys/class/net holding fake devices, so no
+#  real disk or interface is needed. Exits non-zero if a table did not react.
+#
+# Usage (from the build directory, after "make injectuevent PiDiskLeds PiNetLeds"):
+#   ./checkhotplug.sh
+
+POLL_MS=20
+PIN=5
+
+if [ "$CHECKHOTPLUG_NAMESPACE" != 1 ]; then
+    if [ "$(id -u)" = 0 ]; then
+        CHECKHOTPLUG_NAMESPACE=1 exec unshare -m "$0" "$@"
+    else
+        CHECKHOTPLUG_NAMESPACE=1 exec unshare -rm "$0" "$@"
+    fi
+    echo "$0: could not create a mount namespace" >&2
+    exit 1
+fi
+
+mount --make-rprivate / 2>/dev/null
+if ! mount -t tmpfs none /sys/block || ! mount -t tmpfs none /sys/class/net; then
+    echo "$0: could not mount over /sys" >&2
+    exit 1
+fi
+
+DIR=$(mktemp -d /tmp/checkhotplug.XXXXXX) || exit 1
+trap 'rm -rf "$DIR"' EXIT
+FAILURES=0
+
+settle() {
+    sleep 0.2
+}
+
+# Counter files keep their length (zero-padded where the programs stop at the first non-digit), so rewriting
+#  them in place (the programs keep them open) leaves no stale digits
+write_disk_stat() {
+    printf '%10d 0 0 0 %10d 0 0 0 0 0 0\n' "$2" "$2" 1<>"/sys/block/$1/stat"
+}
+
+write_interface_counters() {
+    printf '%010d\n' "$2" 1<>"/sys/class/net/$1/statistics/rx_packets"
+    printf '%010d\n' "$2" 1<>"/sys/class/net/$1/statistics/tx_packets"
+}
+
+add_disk() {
+    mkdir -p "/sys/block/$1" && : >"/sys/block/$1/stat" && write_disk_stat "$1" 0
+}
+
+add_interface() {
+    mkdir -p "/sys/class/net/$1/statistics" && : >"/sys/class/net/$1/statistics/rx_packets" && : >"/sys/class/net/$1/statistics/tx_packets" && write_interface_counters "$1" 0
+}
+
+wait_for_socket() {
+    for i in 1 2 3 4 5 6 7 8 9 10; do
+        [ -S "$1" ] && return 0
+        sleep 0.1
+    done
+    echo "$0: $1 was not created" >&2
+    return 1
+}
+
+# Rising edges of the pin in a waveform
+count_pulses() {
+    awk -v pin="pin$PIN" '
+        $1 == "$var" && $5 == pin { id = $4 }
+        id != "" && $0 == "1" id  { pulses++ }
+        END                       { print pulses + 0 }' "$1"
+}
+
+check() {
+    if [ "$2" = "$3" ]; then
+        echo "$1: ok"
+    else
+        echo "$1: expected $2 activity pulses, saw $3" >&2
+        FAILURES=$((FAILURES + 1))
+    fi
+}
+
+# $1: program, $2: block|net, $3: table option, $4: fake statistics file contents, $5: add function,
+#  $6: counter function, $7: sysfs directory of the devices
+run_table_check() {
+    printf "$4" >"$DIR/stats"
+    "./$1" -p $POLL_MS -S "$DIR/$2.vcd" -f "$DIR/stats" "$3" "fake*@$PIN" -u "$DIR/$2.sock" 2>/dev/null &
+    pid=$!
+    wait_for_socket "$DIR/$2.sock" || { kill $pid; return 1; }
+
+    # Plugged in: watched once the add event is seen, and lights on activity after its first poll
+    $5 fakea
+    ./injectuevent "$DIR/$2.sock" add "$2" fakea
+    settle
+    $6 fakea 1
+    settle
+
+    # Renamed: the old entry is dropped and the new name watched
+    $5 fakeb
+    rm -r "$7/fakea"
+    ./injectuevent "$DIR/$2.sock" move "$2" fakeb fakea
+    settle
+    $6 fakeb 2
+    settle
+
+    # Removed: the counters are still readable here, so only the remove event can stop the watch
+    ./injectuevent "$DIR/$2.sock" remove "$2" fakeb
+    settle
+    $6 fakeb 3
+    settle
+
+    # Not matching the pattern: never watched
+    $5 other
+    ./injectuevent "$DIR/$2.sock" add "$2" other
+    settle
+    $6 other 1
+    settle
+
+    kill -TERM $pid
+    wait $pid
+
+    check "$1 $2 add/rename/remove" 2 "$(count_pulses "$DIR/$2.vcd")"
+}
+
+run_table_check PiDiskLeds block -b 'pgpgin 0\npgpgout 0\n' add_disk write_disk_stat /sys/block
+run_table_check PiNetLeds net -i 'Inter-|\n face |\n' add_interface write_interface_counters /sys/class/net
+
+[ $FAILURES = 0 ]
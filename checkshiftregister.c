@@ -0,0 +1,378 @@
+/**************************************************************************
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ **************************************************************************/
+
+/**************************************************************************
+ * Test helper: drives the bit-banged shift register output through its
+ *  write_pin hook into a model of a chain of 74HC595s (shift on the rising
+ *  edge of SRCLK, copy to the outputs on the rising edge of RCLK), then
+ *  rebuilds each latched frame and compares it with the frame sent and,
+ *  for bar graphs, with the segments known rates must light. Also checks
+ *  the bit order, the latch pulse, that an unchanged frame is not shifted
+ *  again and that the log scale never goes down as the rate goes up.
+ *  Exits non-zero on any mismatch.
+ *
+ * Usage:
+ *   checkshiftregister
+ **************************************************************************/
+
+
+/* Using GNU extensions to ISO standards */
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "gpio.h"
+#include "shiftregister.h"
+
+#define DATA_PIN                          17
+#define CLOCK_PIN                         27
+#define LATCH_PIN                         22
+#define PIN_SPEC                          "@17,27,22"
+
+/* Every data bit toggling: one data write and two clock writes per bit, plus the latch pulse */
+#define MAX_PIN_WRITES( bits )            (3 * (bits) + 2)
+
+
+/* What a chain of 74HC595s sees on its three inputs; bit 0 is Q0 of the first register */
+struct chain_model
+{
+    unsigned int bits;
+    int          data;
+    int          clock;
+    int          latch;
+    uint64_t     shift;
+    uint64_t     outputs;
+    unsigned int clocks;                                /* Rising SRCLK edges since the last latch */
+    unsigned int latches;
+    unsigned int pin_writes;
+    unsigned int errors;
+};
+
+struct bar_graph_case
+{
+    const char*        spec;
+    unsigned long long rate;
+    unsigned int       lit;                             /* Lowest segments expected on */
+};
+
+
+static struct chain_model Chain;
+
+/* A rate of 1 lights one segment and the full scale all of them; in between, one more segment per
+ *  (log2(full scale)) / (segments - 1) doublings, rounded down on a 1/16 log2 grid
+ */
+static const struct bar_graph_case Bar_Graph_Cases[] =
+{
+    { "32:1000", 0,        0  },
+    { "32:1000", 1,        1  },
+    { "32:1000", 2,        4  },
+    { "32:1000", 3,        5  },
+    { "32:1000", 10,       11 },
+    { "32:1000", 31,       16 },
+    { "32:1000", 100,      21 },
+    { "32:1000", 500,      28 },
+    { "32:1000", 999,      32 },
+    { "32:1000", 1000,     32 },
+    { "32:1000", 12345678, 32 },
+    { "8:256",   0,        0  },
+    { "8:256",   1,        1  },
+    { "8:256",   2,        1  },
+    { "8:256",   16,       4  },
+    { "8:256",   128,      7  },
+    { "8:256",   255,      7  },
+    { "8:256",   256,      8  },
+    { "8:256",   257,      8  },
+    { "12:1000", 1,        1  },
+    { "12:1000", 1000,     12 },
+    { "12:1000", 5000,     12 },                        /* Outputs 12 to 15 of the second register stay dark */
+    { "1:5",     0,        0  },
+    { "1:5",     1,        1  },
+    { "1:5",     4,        1  },
+    { "1:5",     5,        1  },
+};
+
+
+static void ModelWritePin( int pin, int value )
+{
+    Chain.pin_writes++;
+
+    if( pin == DATA_PIN )
+    {
+        Chain.data = value;
+    }
+    else if( pin == CLOCK_PIN )
+    {
+        if( (Chain.clock == GPIO_LOW) && (value == GPIO_HIGH) )
+        {
+            if( Chain.latch == GPIO_HIGH )
+            {
+                fprintf( stderr, "SRCLK rose while RCLK was high\n" );
+                Chain.errors++;
+            }
+
+            Chain.shift = ((Chain.shift << 1) | (uint64_t)Chain.data) & ((UINT64_C(1) << Chain.bits) - 1);
+            Chain.clocks++;
+        }
+        Chain.clock = value;
+    }
+    else if( pin == LATCH_PIN )
+    {
+        if( (Chain.latch == GPIO_LOW) && (value == GPIO_HIGH) )
+        {
+            if( Chain.clock == GPIO_HIGH )
+            {
+                fprintf( stderr, "RCLK rose while SRCLK was high\n" );
+                Chain.errors++;
+            }
+
+            Chain.outputs = Chain.shift;
+            Chain.latches++;
+        }
+        Chain.latch = value;
+    }
+    else
+    {
+        fprintf( stderr, "write to unexpected pin %d\n", pin );
+        Chain.errors++;
+    }
+}
+
+
+/* Start a chain in an unknown state, as at power-up */
+static void ResetModel( unsigned int bits )
+{
+    memset( &Chain, 0, sizeof(Chain) );
+    Chain.bits    = bits;
+    Chain.data    = -1;
+    Chain.clock   = -1;
+    Chain.latch   = -1;
+    Chain.shift   = 0x5A5A5A5A5A5A5A5AULL & ((UINT64_C(1) << bits) - 1);
+    Chain.outputs = Chain.shift;
+}
+
+
+static void OpenOutput( struct shift_register* output )
+{
+    output->write_pin = ModelWritePin;
+
+    if( ShiftRegisterOpen(output) != 0 )
+    {
+        fprintf( stderr, "could not open the shift register output\n" );
+        Chain.errors++;
+    }
+}
+
+
+/* Shift one frame out and check what the chain latched; a frame the registers already hold must cause no pin write */
+static unsigned int CheckUpdate( struct shift_register* output, uint32_t frame, bool unchanged )
+{
+    unsigned int failures = 0;
+    unsigned int latches  = Chain.latches;
+
+    Chain.clocks     = 0;
+    Chain.pin_writes = 0;
+    Chain.errors     = 0;
+
+    if( ShiftRegisterUpdate(output, frame) != 0 )
+    {
+        fprintf( stderr, "frame 0x%08x: update failed\n", frame );
+        return 1;
+    }
+
+    if( unchanged == true )
+    {
+        if( Chain.pin_writes != 0 )
+        {
+            fprintf( stderr, "frame 0x%08x: shifted out again, %u pin writes\n", frame, Chain.pin_writes );
+            failures++;
+        }
+        return failures;
+    }
+
+    if( (Chain.latches != latches + 1) || (Chain.latch != GPIO_LOW) || (Chain.clock != GPIO_LOW) )
+    {
+        fprintf( stderr, "frame 0x%08x: %u latch pulses, RCLK left %d, SRCLK left %d\n", frame, Chain.latches - latches, Chain.latch, Chain.clock );
+        failures++;
+    }
+
+    if( Chain.clocks != output->bits )
+    {
+        fprintf( stderr, "frame 0x%08x: %u clocks for %u bits\n", frame, Chain.clocks, output->bits );
+        failures++;
+    }
+
+    if( Chain.outputs != frame )
+    {
+        fprintf( stderr, "frame 0x%08x: latched 0x%08llx\n", frame, (unsigned long long)Chain.outputs );
+        failures++;
+    }
+
+    if( Chain.pin_writes > MAX_PIN_WRITES(output->bits) )
+    {
+        fprintf( stderr, "frame 0x%08x: %u pin writes, more than %u\n", frame, Chain.pin_writes, MAX_PIN_WRITES(output->bits) );
+        failures++;
+    }
+
+    return failures + Chain.errors;
+}
+
+
+/* Raw frames on a full 32-bit chain: single bits for the order, alternating bits for the data pin */
+static unsigned int CheckFrames( void )
+{
+    static const uint32_t frames[] = { 0x00000001, 0x00000080, 0x00000100, 0x80000000, 0xAAAAAAAA, 0x55555555, 0xFFFFFFFF, 0x00000000, 0x0000FFFF };
+    struct bar_graph      graph;
+    unsigned int          failures = 0;
+
+    if( BarGraphParse("32:1000" PIN_SPEC, &graph) == false )
+    {
+        fprintf( stderr, "could not parse 32:1000%s\n", PIN_SPEC );
+        return 1;
+    }
+
+    ResetModel( graph.output.bits );
+    OpenOutput( &graph.output );
+    if( (Chain.errors != 0) || (Chain.latches != 1) || (Chain.outputs != 0) )
+    {
+        fprintf( stderr, "opening did not latch a dark frame\n" );
+        failures++;
+    }
+
+    for( size_t index = 0; index < sizeof(frames) / sizeof(frames[0]); index++ )
+    {
+        failures += CheckUpdate( &graph.output, frames[index], false );
+        failures += CheckUpdate( &graph.output, frames[index], true );
+    }
+
+    ShiftRegisterClose( &graph.output );
+    if( Chain.outputs != 0 )
+    {
+        fprintf( stderr, "closing left 0x%08llx latched\n", (unsigned long long)Chain.outputs );
+        failures++;
+    }
+
+    printf( "frames: %zu frames, %u latch pulses, %u failures\n", sizeof(frames) / sizeof(frames[0]), Chain.latches, failures );
+
+    return failures;
+}
+
+
+static unsigned int CheckBarGraphs( void )
+{
+    unsigned int failures = 0;
+    size_t       count    = sizeof(Bar_Graph_Cases) / sizeof(Bar_Graph_Cases[0]);
+
+    for( size_t index = 0; index < count; index++ )
+    {
+        const struct bar_graph_case* test = &Bar_Graph_Cases[index];
+        char                         spec[64];
+        struct bar_graph             graph;
+        uint32_t                     expected;
+        uint32_t                     frame;
+
+        snprintf( spec, sizeof(spec), "%s%s", test->spec, PIN_SPEC );
+        if( BarGraphParse(spec, &graph) == false )
+        {
+            fprintf( stderr, "could not parse %s\n", spec );
+            failures++;
+            continue;
+        }
+
+        expected = (test->lit >= 32) ? UINT32_MAX : ((UINT32_C(1) << test->lit) - 1);
+        frame    = BarGraphFrame( &graph, test->rate );
+        if( frame != expected )
+        {
+            fprintf( stderr, "%s, rate %llu: frame 0x%08x, expected 0x%08x\n", test->spec, test->rate, frame, expected );
+            failures++;
+        }
+
+        ResetModel( graph.output.bits );
+        OpenOutput( &graph.output );
+        failures += CheckUpdate( &graph.output, frame, (frame == 0) );
+        ShiftRegisterClose( &graph.output );
+    }
+
+    printf( "bar graphs: %zu rates, %u failures\n", count, failures );
+
+    return failures;
+}
+
+
+/* Every rate up to twice the full scale: a solid run of the lowest segments, never shorter than for a lower rate */
+static unsigned int CheckScale( const char* spec )
+{
+    struct bar_graph   graph;
+    unsigned int       failures = 0;
+    uint32_t           previous = 0;
+
+    if( BarGraphParse(spec, &graph) == false )
+    {
+        fprintf( stderr, "could not parse %s\n", spec );
+        return 1;
+    }
+
+    for( unsigned long long rate = 0; rate <= 2 * graph.full_scale; rate++ )
+    {
+        uint32_t frame = BarGraphFrame( &graph, rate );
+
+        if( ((frame & (frame + 1)) != 0) || (frame < previous) || ((rate > 0) && (frame == 0))
+         || ((rate >= graph.full_scale) && (frame != ((graph.segments >= 32) ? UINT32_MAX : ((UINT32_C(1) << graph.segments) - 1)))) )
+        {
+            fprintf( stderr, "%s, rate %llu: frame 0x%08x after 0x%08x\n", spec, rate, frame, previous );
+            failures++;
+        }
+        previous = frame;
+    }
+
+    printf( "scale %s: %u failures\n", spec, failures );
+
+    return failures;
+}
+
+
+int main( int argc, char **argv )
+{
+    unsigned int failures;
+
+    if( argc != 1 )
+    {
+        fprintf( stderr, "Usage: %s\n", argv[0] );
+        return EXIT_FAILURE;
+    }
+
+    failures  = CheckFrames();
+    failures += CheckBarGraphs();
+    failures += CheckScale( "32:1000" PIN_SPEC );
+    failures += CheckScale( "10:100000" PIN_SPEC );
+    failures += CheckScale( "3:7" PIN_SPEC );
+
+    return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
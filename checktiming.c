@@ -0,0 +1,419 @@
+/**************************************************************************
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ **************************************************************************/
+
+/**************************************************************************
+ * Test helper: runs PiDiskLeds or PiNetLeds with simulated GPIO pins and a
+ *  fake statistics file, moves the read (received) and write (transmitted)
+ *  counters in turn a fixed number of times, then reads back the waveform.
+ *  Exits non-zero if an LED took longer than the allowed latency to light
+ *  after its counter moved, or lit for a shorter pulse than allowed.
+ *
+ * Usage:
+ *   checktiming disk|net PROGRAM [POLL_MS [MAX_LATENCY_MS [MIN_PULSE_MS]]]
+ *
+ *  By default the program polls every 20 ms, and an LED must light within
+ *  two poll intervals and stay lit for at least half of one.
+ **************************************************************************/
+
+
+/* Using GNU extensions to ISO standards */
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/wait.h>
+
+#define NANOSECONDS_PER_SECOND            1000000000ULL
+#define NANOSECONDS_PER_MILLISECOND       1000000ULL
+
+#define DEFAULT_POLL_MILLISECONDS         20
+#define BURST_COUNT                       20
+#define READ_LED_PIN                      3
+#define WRITE_LED_PIN                     4
+#define MAX_PINS                          32
+#define MAX_EDGES                         1024
+#define MAX_PATH_LENGTH                   256
+#define MAX_STATS_LENGTH                  256
+
+#define TEMP_DIRECTORY_TEMPLATE           "/tmp/checktiming.XXXXXX"
+#define VCD_ORIGIN_PREFIX                 "$comment time 0 is CLOCK_MONOTONIC "
+
+
+/* Rising and falling edges of one LED, in CLOCK_MONOTONIC nanoseconds */
+struct led_edges
+{
+    uint64_t     rising[MAX_EDGES];
+    uint64_t     falling[MAX_EDGES];
+    unsigned int rising_count;
+    unsigned int falling_count;
+};
+
+
+static bool             Network                   = false;
+static char             Directory[MAX_PATH_LENGTH];
+static char             Stats_File_Name[MAX_PATH_LENGTH];
+static char             Waveform_File_Name[MAX_PATH_LENGTH];
+static struct led_edges Edges[MAX_PINS];
+
+
+static uint64_t MonotonicNanoseconds( void )
+{
+    struct timespec now;
+
+    clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ((uint64_t)now.tv_sec * NANOSECONDS_PER_SECOND) + now.tv_nsec;
+}
+
+
+static void SleepMilliseconds( unsigned int milliseconds )
+{
+    struct timespec delay = { .tv_sec = milliseconds / 1000, .tv_nsec = (milliseconds % 1000) * NANOSECONDS_PER_MILLISECOND };
+
+    while( nanosleep(&delay, &delay) < 0 )
+        ;
+}
+
+
+/* Rewrite the fake statistics file in place; the programs keep it open */
+static int WriteStats( int stats_fd, unsigned long long reads, unsigned long long writes )
+{
+    char stats[MAX_STATS_LENGTH];
+    int  length;
+
+    if( Network == true )
+        length = snprintf( stats, sizeof(stats), "Inter-|   Receive\n face |packets\n  fake0: 0 %llu 0 0 0 0 0 0 0 %llu 0 0 0 0 0 0\n", reads, writes );
+    else                                                    /* PiDiskLeds' default counters: pgpgout is shown as reads */
+        length = snprintf( stats, sizeof(stats), "pgpgin %llu\npgpgout %llu\n", writes, reads );
+
+    if( (pwrite(stats_fd, stats, length, 0) != length) || (ftruncate(stats_fd, length) != 0) )
+    {
+        perror( Stats_File_Name );
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static pid_t StartProgram( const char* program, unsigned int poll_milliseconds )
+{
+    char  poll[16];
+    pid_t pid;
+
+    snprintf( poll, sizeof(poll), "%u", poll_milliseconds );
+
+    pid = fork();
+    if( pid == 0 )
+    {
+        execl( program, program, "-p", poll, "-r", "3", Network ? "-t" : "-w", "4", "-S", Waveform_File_Name, "-f", Stats_File_Name, (char*)NULL );
+        perror( program );
+        _exit( EXIT_FAILURE );
+    }
+
+    if( pid < 0 )
+        perror( "fork" );
+
+    return pid;
+}
+
+
+/* Collect the edges of every pin from the waveform; PWM pins count as lit at any level above 0 */
+static int ReadWaveform( void )
+{
+    FILE*    fp_waveform      = fopen( Waveform_File_Name, "r" );
+    char*    line_buffer      = NULL;
+    size_t   line_buffer_size = 0;
+    char     identifiers[MAX_PINS];
+    int      levels[MAX_PINS];
+    uint64_t origin           = 0;
+    uint64_t time             = 0;
+    int      status           = -1;
+
+    if( fp_waveform == NULL )
+    {
+        perror( Waveform_File_Name );
+        return -1;
+    }
+
+    memset( identifiers, 0, sizeof(identifiers) );
+    memset( levels, 0, sizeof(levels) );
+
+    while( getline(&line_buffer, &line_buffer_size, fp_waveform) > 0 )
+    {
+        unsigned long long seconds;
+        unsigned long      nanoseconds;
+        unsigned long long timestamp;
+        char               identifier;
+        int                pin;
+        int                level;
+        char*              value_end;
+
+        if( strncmp(line_buffer, VCD_ORIGIN_PREFIX, strlen(VCD_ORIGIN_PREFIX)) == 0 )
+        {
+            if( sscanf(line_buffer + strlen(VCD_ORIGIN_PREFIX), "%llu.%lu", &seconds, &nanoseconds) == 2 )
+                origin = (seconds * NANOSECONDS_PER_SECOND) + nanoseconds;
+            continue;
+        }
+
+        if( sscanf(line_buffer, "$var wire %*d %c pin%d", &identifier, &pin) == 2 )
+        {
+            if( (pin >= 0) && (pin < MAX_PINS) )
+                identifiers[pin] = identifier;
+            continue;
+        }
+
+        if( sscanf(line_buffer, "#%llu", &timestamp) == 1 )
+        {
+            time = origin + timestamp;
+            continue;
+        }
+
+        /* "1x" / "0x" for a plain pin, "b1100100 x" for a PWM level */
+        if( line_buffer[0] == 'b' )
+        {
+            level      = (strtoul(line_buffer + 1, &value_end, 2) != 0);
+            identifier = value_end[(*value_end == ' ') ? 1 : 0];
+        }
+        else if( (line_buffer[0] == '0') || (line_buffer[0] == '1') )
+        {
+            level      = (line_buffer[0] == '1');
+            identifier = line_buffer[1];
+        }
+        else
+        {
+            continue;
+        }
+
+        for( pin = 0; pin < MAX_PINS; pin++ )
+        {
+            struct led_edges* edges = &Edges[pin];
+
+            if( (identifiers[pin] != identifier) || (identifiers[pin] == 0) || (levels[pin] == level) )
+                continue;
+
+            levels[pin] = level;
+            if( (level != 0) && (edges->rising_count < MAX_EDGES) )
+                edges->rising[edges->rising_count++] = time;
+            else if( (level == 0) && (edges->falling_count < MAX_EDGES) )
+                edges->falling[edges->falling_count++] = time;
+        }
+    }
+
+    if( origin == 0 )
+        fprintf( stderr, "%s: no time origin found\n", Waveform_File_Name );
+    else
+        status = 0;
+
+    free( line_buffer );
+    fclose( fp_waveform );
+
+    return status;
+}
+
+
+/* Latency from each time the counter moved to the first rising edge after it, and every pulse's width */
+static unsigned int CheckLed( const char* name, int pin, const uint64_t* moved, unsigned int moved_count,
+                              uint64_t max_latency, uint64_t min_pulse )
+{
+    const struct led_edges* edges      = &Edges[pin];
+    unsigned int            failures   = 0;
+    uint64_t                worst      = 0;
+    uint64_t                narrowest  = UINT64_MAX;
+    unsigned int            edge       = 0;
+
+    for( unsigned int index = 0; index < moved_count; index++ )
+    {
+        uint64_t latency;
+
+        while( (edge < edges->rising_count) && (edges->rising[edge] < moved[index]) )
+            edge++;
+
+        latency = (edge < edges->rising_count) ? (edges->rising[edge] - moved[index]) : UINT64_MAX;
+        if( latency > max_latency )
+        {
+            if( latency == UINT64_MAX )
+                fprintf( stderr, "%s LED: activity %u never lit it\n", name, index + 1 );
+            else
+                fprintf( stderr, "%s LED: activity %u took %.3f ms to light it\n", name, index + 1, latency / 1e6 );
+            failures++;
+        }
+        else if( latency > worst )
+        {
+            worst = latency;
+        }
+    }
+
+    /* Pulses that ended; the first falling edge may be the LEDs being turned off at start-up */
+    for( unsigned int index = 0; index < edges->rising_count; index++ )
+    {
+        unsigned int falling = 0;
+        uint64_t     width;
+
+        while( (falling < edges->falling_count) && (edges->falling[falling] < edges->rising[index]) )
+            falling++;
+        if( falling == edges->falling_count )
+            break;
+
+        width = edges->falling[falling] - edges->rising[index];
+        if( width < min_pulse )
+        {
+            fprintf( stderr, "%s LED: pulse %u lasted only %.3f ms\n", name, index + 1, width / 1e6 );
+            failures++;
+        }
+        else if( width < narrowest )
+        {
+            narrowest = width;
+        }
+    }
+
+    printf( "%s LED: %u activities, %u pulses, worst latency %.3f ms, shortest pulse %.3f ms, %u failures\n",
+            name, moved_count, edges->rising_count, worst / 1e6, (narrowest == UINT64_MAX) ? 0.0 : (narrowest / 1e6), failures );
+
+    return failures;
+}
+
+
+int main( int argc, char **argv )
+{
+    unsigned int       poll_milliseconds = DEFAULT_POLL_MILLISECONDS;
+    uint64_t           max_latency;
+    uint64_t           min_pulse;
+    int                stats_fd          = -1;
+    pid_t              pid               = -1;
+    int                status            = EXIT_FAILURE;
+    int                child_status;
+    unsigned long long reads             = 0;
+    unsigned long long writes            = 0;
+    uint64_t           read_moved[BURST_COUNT];
+    uint64_t           write_moved[BURST_COUNT];
+    unsigned int       failures;
+
+    if( (argc < 3) || (argc > 6) || ((strcmp(argv[1], "disk") != 0) && (strcmp(argv[1], "net") != 0)) )
+    {
+        fprintf( stderr, "Usage: %s disk|net PROGRAM [POLL_MS [MAX_LATENCY_MS [MIN_PULSE_MS]]]\n", argv[0] );
+        return EXIT_FAILURE;
+    }
+
+    Network = (strcmp(argv[1], "net") == 0);
+    if( argc > 3 )
+        poll_milliseconds = strtoul( argv[3], NULL, 10 );
+    if( poll_milliseconds == 0 )
+        poll_milliseconds = DEFAULT_POLL_MILLISECONDS;
+
+    max_latency = ((argc > 4) ? strtoull(argv[4], NULL, 10) : (2ULL * poll_milliseconds)) * NANOSECONDS_PER_MILLISECOND;
+    min_pulse   = (argc > 5) ? (strtoull(argv[5], NULL, 10) * NANOSECONDS_PER_MILLISECOND) : (poll_milliseconds * NANOSECONDS_PER_MILLISECOND / 2);
+
+    strcpy( Directory, TEMP_DIRECTORY_TEMPLATE );
+    if( mkdtemp(Directory) == NULL )
+    {
+        perror( Directory );
+        return EXIT_FAILURE;
+    }
+    snprintf( Stats_File_Name, sizeof(Stats_File_Name), "%s/stats", Directory );
+    snprintf( Waveform_File_Name, sizeof(Waveform_File_Name), "%s/leds.vcd", Directory );
+
+    stats_fd = open( Stats_File_Name, O_RDWR | O_CREAT | O_CLOEXEC, 0644 );
+    if( stats_fd < 0 )
+    {
+        perror( Stats_File_Name );
+        goto out;
+    }
+
+    if( WriteStats(stats_fd, reads, writes) != 0 )
+        goto out;
+
+    pid = StartProgram( argv[2], poll_milliseconds );
+    if( pid < 0 )
+        goto out;
+
+    /* Let it start up and take its first counts */
+    SleepMilliseconds( 10 * poll_milliseconds );
+
+    /* Move one counter at a time, leaving its LED time to go out again before the next burst */
+    for( unsigned int index = 0; index < BURST_COUNT; index++ )
+    {
+        bool read = ((index % 2) == 0);
+
+        if( read == true )
+            reads += 8;
+        else
+            writes += 8;
+
+        /* Noted before the write, so a program that sees the change at once still lights after it */
+        if( read == true )
+            read_moved[index / 2] = MonotonicNanoseconds();
+        else
+            write_moved[index / 2] = MonotonicNanoseconds();
+
+        if( WriteStats(stats_fd, reads, writes) != 0 )
+            goto out;
+
+        SleepMilliseconds( 5 * poll_milliseconds );
+    }
+
+    kill( pid, SIGTERM );
+    if( (waitpid(pid, &child_status, 0) != pid) || (WIFEXITED(child_status) == false) || (WEXITSTATUS(child_status) != EXIT_SUCCESS) )
+    {
+        fprintf( stderr, "%s did not exit cleanly\n", argv[2] );
+        pid = -1;
+        goto out;
+    }
+    pid = -1;
+
+    if( ReadWaveform() != 0 )
+        goto out;
+
+    failures  = CheckLed( Network ? "rx" : "read", READ_LED_PIN, read_moved, BURST_COUNT / 2, max_latency, min_pulse );
+    failures += CheckLed( Network ? "tx" : "write", WRITE_LED_PIN, write_moved, BURST_COUNT / 2, max_latency, min_pulse );
+
+    if( failures == 0 )
+        status = EXIT_SUCCESS;
+
+out:
+    if( pid > 0 )
+    {
+        kill( pid, SIGTERM );
+        waitpid( pid, NULL, 0 );
+    }
+
+    if( stats_fd >= 0 )
+        close( stats_fd );
+
+    unlink( Stats_File_Name );
+    unlink( Waveform_File_Name );
+    rmdir( Directory );
+
+    return status;
+}
@@ -0,0 +1,339 @@
+/**************************************************************************
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ **************************************************************************/
+
+/**************************************************************************
+ * GPIO access for PiDiskLeds and PiNetLeds, either through WiringPi or
+ *  simulated.
+ *
+ * The simulated backend records every pin write with its CLOCK_MONOTONIC
+ *  time into a buffer allocated up front, so recording costs a clock read
+ *  and a store. At exit the recording is written out as a Value Change
+ *  Dump (viewable with e.g. GTKWave), and a summary of writes per second
+ *  and of the shortest pulses on each pin is printed, so timing can be
+ *  checked on any Linux box against fake statistics files.
+ **************************************************************************/
+
+
+/* Using GNU extensions to ISO standards */
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef GPIO_SIMULATED_ONLY
+    #include <wiringPi.h>
+    #include <softPwm.h>
+#endif
+
+#include "gpio.h"
+
+#define NANOSECONDS_PER_SECOND            1000000000ULL
+#define VCD_FIRST_IDENTIFIER              '!'
+
+typedef enum
+{
+    PIN_UNUSED = 0,
+    PIN_DIGITAL,
+    PIN_PWM
+} pin_kind_t;
+
+struct transition
+{
+    uint64_t           time;               /* Nanoseconds since GpioSetup() */
+    uint8_t            pin;
+    uint8_t            value;
+};
+
+static bool               Simulated                 = false;
+static const char*        Waveform_File_Name        = NULL;
+static struct transition* Transitions               = NULL;
+static size_t             Transition_Count          = 0;
+static unsigned long long Dropped_Transitions       = 0;
+static struct timespec    Origin;
+static pin_kind_t         Pin_Kinds[GPIO_MAX_PINS];
+static unsigned int       Pwm_Ranges[GPIO_MAX_PINS];
+
+
+static uint64_t Now( void )
+{
+    struct timespec now;
+
+    clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return ((uint64_t)(now.tv_sec - Origin.tv_sec) * NANOSECONDS_PER_SECOND) + now.tv_nsec - Origin.tv_nsec;
+}
+
+
+static void Record( int pin, int value )
+{
+    /* Not set up (yet) */
+    if( Transitions == NULL )
+        return;
+
+    if( Transition_Count == GPIO_SIM_MAX_TRANSITIONS )
+    {
+        Dropped_Transitions++;
+        return;
+    }
+
+    Transitions[Transition_Count].time  = Now();
+    Transitions[Transition_Count].pin   = pin;
+    Transitions[Transition_Count].value = value;
+    Transition_Count++;
+}
+
+
+int GpioSetup( const char* waveform_file_name )
+{
+#ifdef GPIO_SIMULATED_ONLY
+    Simulated = true;
+#else
+    Simulated = (waveform_file_name != NULL);
+    if( Simulated == false )
+        return wiringPiSetup();
+#endif
+
+    Waveform_File_Name = waveform_file_name;
+    Transitions        = malloc( GPIO_SIM_MAX_TRANSITIONS * sizeof(*Transitions) );
+    if( Transitions == NULL )
+    {
+        perror( GPIO_SIM_OUT_OF_MEMORY_MSG );
+        return -1;
+    }
+
+    clock_gettime( CLOCK_MONOTONIC, &Origin );
+
+    return 0;
+}
+
+
+bool GpioSimulated( void )
+{
+    return Simulated;
+}
+
+
+void GpioPinMode( int pin )
+{
+    if( (pin < 0) || (pin >= GPIO_MAX_PINS) )
+        return;
+
+    if( Pin_Kinds[pin] == PIN_UNUSED )
+        Pin_Kinds[pin] = PIN_DIGITAL;
+
+#ifndef GPIO_SIMULATED_ONLY
+    if( Simulated == false )
+        pinMode( pin, OUTPUT );
+#endif
+}
+
+
+void GpioWrite( int pin, int value )
+{
+#ifndef GPIO_SIMULATED_ONLY
+    if( Simulated == false )
+    {
+        digitalWrite( pin, value );
+        return;
+    }
+#endif
+
+    Record( pin, (value != GPIO_LOW) ? GPIO_HIGH : GPIO_LOW );
+}
+
+
+void GpioPwmCreate( int pin, int range )
+{
+    if( (pin < 0) || (pin >= GPIO_MAX_PINS) )
+        return;
+
+    Pin_Kinds[pin]  = PIN_PWM;
+    Pwm_Ranges[pin] = range;
+
+#ifndef GPIO_SIMULATED_ONLY
+    if( Simulated == false )
+    {
+        softPwmCreate( pin, 0, range );
+        return;
+    }
+#endif
+
+    Record( pin, 0 );
+}
+
+
+void GpioPwmWrite( int pin, int value )
+{
+#ifndef GPIO_SIMULATED_ONLY
+    if( Simulated == false )
+    {
+        softPwmWrite( pin, value );
+        return;
+    }
+#endif
+
+    Record( pin, value );
+}
+
+
+/* VCD identifier of a pin: one printable character each */
+static char VcdIdentifier( int pin )
+{
+    return VCD_FIRST_IDENTIFIER + pin;
+}
+
+
+static void WriteVcdValue( FILE* fp_waveform, int pin, unsigned int value )
+{
+    if( Pin_Kinds[pin] == PIN_PWM )
+    {
+        fputc( 'b', fp_waveform );
+        for( int bit = 7; bit >= 0; bit-- )
+            fputc( ((value >> bit) & 1) ? '1' : '0', fp_waveform );
+        fprintf( fp_waveform, " %c\n", VcdIdentifier(pin) );
+    }
+    else
+    {
+        fprintf( fp_waveform, "%u%c\n", value, VcdIdentifier(pin) );
+    }
+}
+
+
+static int WriteVcd( const char* file_name, uint64_t end_time )
+{
+    FILE*    fp_waveform = fopen( file_name, "w" );
+    int      values[GPIO_MAX_PINS];
+    uint64_t time        = UINT64_MAX;
+
+    if( fp_waveform == NULL )
+        return -1;
+
+    fprintf( fp_waveform, "$version PiInfoLeds simulated GPIO $end\n" );
+    fprintf( fp_waveform, "$comment time 0 is CLOCK_MONOTONIC %lld.%09ld s $end\n", (long long)Origin.tv_sec, Origin.tv_nsec );
+    fprintf( fp_waveform, "$timescale 1ns $end\n" );
+    fprintf( fp_waveform, "$scope module gpio $end\n" );
+
+    for( int pin = 0; pin < GPIO_MAX_PINS; pin++ )
+    {
+        values[pin] = -1;
+
+        if( Pin_Kinds[pin] != PIN_UNUSED )
+            fprintf( fp_waveform, "$var wire %d %c pin%d $end\n", (Pin_Kinds[pin] == PIN_PWM) ? 8 : 1, VcdIdentifier(pin), pin );
+    }
+
+    fprintf( fp_waveform, "$upscope $end\n" );
+    fprintf( fp_waveform, "$enddefinitions $end\n" );
+
+    /* Only actual changes go in the dump; repeated writes of the same value are just counted */
+    for( size_t index = 0; index < Transition_Count; index++ )
+    {
+        const struct transition* transition = &Transitions[index];
+
+        if( (Pin_Kinds[transition->pin] == PIN_UNUSED) || (values[transition->pin] == transition->value) )
+            continue;
+
+        if( transition->time != time )
+        {
+            time = transition->time;
+            fprintf( fp_waveform, "#%llu\n", (unsigned long long)time );
+        }
+
+        WriteVcdValue( fp_waveform, transition->pin, transition->value );
+        values[transition->pin] = transition->value;
+    }
+
+    fprintf( fp_waveform, "#%llu\n", (unsigned long long)end_time );
+
+    return (fclose(fp_waveform) == 0) ? 0 : -1;
+}
+
+
+/* Writes per second overall, then per pin the number of changes and the shortest high and low pulses */
+static void PrintSummary( uint64_t end_time )
+{
+    double seconds = (double)end_time / NANOSECONDS_PER_SECOND;
+
+    fprintf( stderr, "gpio: %zu writes in %.3f s (%.1f writes/s), %llu dropped\n",
+             Transition_Count, seconds, (seconds > 0) ? (Transition_Count / seconds) : 0.0, Dropped_Transitions );
+
+    for( int pin = 0; pin < GPIO_MAX_PINS; pin++ )
+    {
+        unsigned long long changes        = 0;
+        uint64_t           shortest_high  = UINT64_MAX;
+        uint64_t           shortest_low   = UINT64_MAX;
+        uint64_t           changed_at     = 0;
+        int                value          = -1;
+
+        if( Pin_Kinds[pin] == PIN_UNUSED )
+            continue;
+
+        for( size_t index = 0; index < Transition_Count; index++ )
+        {
+            const struct transition* transition = &Transitions[index];
+            int                      new_value  = (transition->value != 0);
+
+            if( (transition->pin != pin) || (new_value == value) )
+                continue;
+
+            /* A pulse only counts once both of its edges have been seen */
+            if( (changes > 1) && (value == GPIO_HIGH) && ((transition->time - changed_at) < shortest_high) )
+                shortest_high = transition->time - changed_at;
+            else if( (changes > 1) && (value == GPIO_LOW) && ((transition->time - changed_at) < shortest_low) )
+                shortest_low = transition->time - changed_at;
+
+            value      = new_value;
+            changed_at = transition->time;
+            changes++;
+        }
+
+        fprintf( stderr, "gpio: pin %d: %llu changes, shortest high %.3f us, shortest low %.3f us\n", pin, changes,
+                 (shortest_high == UINT64_MAX) ? 0.0 : (shortest_high / 1e3), (shortest_low == UINT64_MAX) ? 0.0 : (shortest_low / 1e3) );
+    }
+}
+
+
+/* Write out the simulated waveform, if any */
+void GpioFinish( void )
+{
+    uint64_t end_time;
+
+    if( (Simulated == false) || (Transitions == NULL) )
+        return;
+
+    end_time = Now();
+
+    if( (Waveform_File_Name != NULL) && (WriteVcd(Waveform_File_Name, end_time) != 0) )
+        perror( GPIO_SIM_WAVEFORM_ERROR_MSG );
+
+    PrintSummary( end_time );
+
+    free( Transitions );
+    Transitions = NULL;
+}
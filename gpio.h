@@ -0,0 +1,30 @@
+#ifndef _GPIO_H
+
+    #define _GPIO_H
+
+    #include <stdbool.h>
+
+    #define GPIO_LOW                          0
+    #define GPIO_HIGH                         1
+    #define GPIO_MAX_PINS                     32
+
+    /* Transitions recorded by the simulated backend; later ones are counted but dropped */
+    #define GPIO_SIM_MAX_TRANSITIONS          262144
+
+    #define GPIO_SIM_OUT_OF_MEMORY_MSG        "Could not allocate the simulated GPIO transition buffer"
+    #define GPIO_SIM_WAVEFORM_ERROR_MSG       "Could not write the simulated GPIO waveform"
+
+    /* Pin access for both daemons. GpioSetup( NULL ) drives the real pins through WiringPi;
+     *  given a file name, nothing is driven, every pin write is time-stamped (CLOCK_MONOTONIC)
+     *  instead, and GpioFinish() writes the recording as a VCD waveform plus a timing summary
+     *  on stderr. Building with "make SIMULATED_GPIO=1" leaves WiringPi out altogether.
+     */
+    int  GpioSetup( const char* waveform_file_name );
+    bool GpioSimulated( void );
+    void GpioPinMode( int pin );
+    void GpioWrite( int pin, int value );
+    void GpioPwmCreate( int pin, int range );
+    void GpioPwmWrite( int pin, int value );
+    void GpioFinish( void );
+
+#endif
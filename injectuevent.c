@@ -0,0 +1,154 @@
+/**************************************************************************
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ **************************************************************************/
+
+/**************************************************************************
+ * Test helper: sends one synthetic kernel uevent to the Unix socket that
+ *  PiDiskLeds or PiNetLeds created with --uevent socket, as if a disk or
+ *  network interface had been plugged in, removed or renamed.
+ *
+ * Usage:
+ *   injectuevent SOCKET add|remove block|net NAME
+ *   injectuevent SOCKET move block|net NAME OLD_NAME
+ **************************************************************************/
+
+
+/* Using GNU extensions to ISO standards */
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "uevent.h"
+
+#define BLOCK_DEVICE_PATH_PREFIX          "/devices/virtual/block/"
+#define NET_DEVICE_PATH_PREFIX            "/devices/virtual/net/"
+
+
+/* Append "KEY=VALUE\0" at length; the new length, or -1 if the event does not fit */
+static int AppendField( char* buffer, int length, const char* key, const char* value )
+{
+    int field_length = snprintf( buffer + length, UEVENT_BUFFER_SIZE - length, "%s=%s", key, value );
+
+    if( (field_length < 0) || (field_length >= (UEVENT_BUFFER_SIZE - length)) )
+        return -1;
+
+    return length + field_length + 1;
+}
+
+
+int main( int argc, char **argv )
+{
+    static char        buffer[UEVENT_BUFFER_SIZE];
+    struct sockaddr_un address  = { .sun_family = AF_UNIX };
+    const char*        action;
+    const char*        subsystem;
+    const char*        name;
+    const char*        prefix;
+    char               devpath[256];
+    char               old_devpath[256];
+    int                length;
+    int                socket_fd;
+    bool               move;
+    bool               block;
+
+    if( argc < 5 )
+        goto usage;
+
+    action    = argv[2];
+    subsystem = argv[3];
+    name      = argv[4];
+    move      = (strcmp(action, UEVENT_ACTION_MOVE) == 0);
+
+    if( ((strcmp(action, UEVENT_ACTION_ADD) != 0) && (strcmp(action, UEVENT_ACTION_REMOVE) != 0) && (move == false))
+     || (argc != (move ? 6 : 5)) || (strlen(argv[1]) >= sizeof(address.sun_path)) )
+        goto usage;
+
+    block = (strcmp(subsystem, UEVENT_SUBSYSTEM_BLOCK) == 0);
+    if( (block == false) && (strcmp(subsystem, UEVENT_SUBSYSTEM_NET) != 0) )
+        goto usage;
+
+    prefix = (block == true) ? BLOCK_DEVICE_PATH_PREFIX : NET_DEVICE_PATH_PREFIX;
+
+    snprintf( devpath, sizeof(devpath), "%s%s", prefix, name );
+
+    /* "ACTION@DEVPATH" first, then the properties, like the kernel sends them */
+    length = snprintf( buffer, sizeof(buffer), "%s@%s", action, devpath ) + 1;
+    length = AppendField( buffer, length, "ACTION", action );
+    if( length > 0 )
+        length = AppendField( buffer, length, "DEVPATH", devpath );
+    if( length > 0 )
+        length = AppendField( buffer, length, "SUBSYSTEM", subsystem );
+
+    if( block == true )
+    {
+        if( length > 0 )
+            length = AppendField( buffer, length, "DEVNAME", name );
+        if( length > 0 )
+            length = AppendField( buffer, length, "DEVTYPE", UEVENT_DEVTYPE_DISK );
+    }
+    else if( length > 0 )
+    {
+        length = AppendField( buffer, length, "INTERFACE", name );
+    }
+
+    if( move == true )
+    {
+        snprintf( old_devpath, sizeof(old_devpath), "%s%s", prefix, argv[5] );
+        if( length > 0 )
+            length = AppendField( buffer, length, "DEVPATH_OLD", old_devpath );
+    }
+
+    if( length < 0 )
+    {
+        fprintf( stderr, "%s: event too long\n", argv[0] );
+        return EXIT_FAILURE;
+    }
+
+    strcpy( address.sun_path, argv[1] );
+
+    socket_fd = socket( AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0 );
+    if( (socket_fd < 0) || (sendto(socket_fd, buffer, length, 0, (struct sockaddr*)&address, sizeof(address)) != length) )
+    {
+        perror( argv[1] );
+        return EXIT_FAILURE;
+    }
+
+    close( socket_fd );
+
+    return EXIT_SUCCESS;
+
+usage:
+    fprintf( stderr, "Usage: %s SOCKET add|remove block|net NAME\n"
+                     "       %s SOCKET move block|net NAME OLD_NAME\n", argv[0], argv[0] );
+
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,150 @@
+/**************************************************************************
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ **************************************************************************/
+
+/**************************************************************************
+ * LED pin bookkeeping shared by PiDiskLeds and PiNetLeds.
+ *
+ * Plain pins are tracked as bit masks, so finding the pins that changed
+ *  since the last tick is a single XOR. Dimmable pins are driven through
+ *  WiringPi's softPwm (one thread per pin, started by LedsAddPin()).
+ **************************************************************************/
+
+
+/* Using GNU extensions to ISO standards */
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "gpio.h"
+#include "leds.h"
+
+#define PIN_BIT(pin)                      (UINT32_C(1) << (pin))
+
+
+static uint32_t      Configured_Pins           = 0;
+static uint32_t      Dimmable_Pins             = 0;
+static uint32_t      Pins_On                   = 0;
+static uint32_t      Pins_Wanted               = 0;
+static unsigned int  Levels[LEDS_MAX_PINS];
+static unsigned int  Wanted_Levels[LEDS_MAX_PINS];
+
+
+/* Make a pin an LED output; a pin used by any dimming rule becomes a softPwm pin */
+void LedsAddPin( unsigned int pin, bool dimmable )
+{
+    if( pin >= LEDS_MAX_PINS )
+        return;
+
+    if( (dimmable == true) && ((Dimmable_Pins & PIN_BIT(pin)) == 0) )
+    {
+        GpioPwmCreate( pin, LED_LEVEL_FULL );
+        Dimmable_Pins |= PIN_BIT( pin );
+        Levels[pin]    = LED_LEVEL_OFF;
+    }
+    else if( (Configured_Pins & PIN_BIT(pin)) == 0 )
+    {
+        GpioPinMode( pin );
+        GpioWrite( pin, GPIO_LOW );
+    }
+
+    Configured_Pins |= PIN_BIT( pin );
+}
+
+
+/* Ask for a pin to be lit on this tick */
+void LedsRequest( unsigned int pin, unsigned int level )
+{
+    if( (pin >= LEDS_MAX_PINS) || (level == LED_LEVEL_OFF) )
+        return;
+
+    if( (Dimmable_Pins & PIN_BIT(pin)) != 0 )
+    {
+        if( level > Wanted_Levels[pin] )
+            Wanted_Levels[pin] = (level > LED_LEVEL_FULL) ? LED_LEVEL_FULL : level;
+    }
+    else
+    {
+        Pins_Wanted |= PIN_BIT( pin );
+    }
+}
+
+
+/* Write the pins whose requested state changed, then start collecting requests for the next tick */
+void LedsUpdate( void )
+{
+    uint32_t changed = (Pins_Wanted ^ Pins_On) & Configured_Pins & ~Dimmable_Pins;
+    uint32_t dimmable;
+
+    while( changed != 0 )
+    {
+        unsigned int pin = __builtin_ctz( changed );
+
+        GpioWrite( pin, ((Pins_Wanted & PIN_BIT(pin)) != 0) ? GPIO_HIGH : GPIO_LOW );
+        changed &= changed - 1;
+    }
+
+    Pins_On     = Pins_Wanted;
+    Pins_Wanted = 0;
+
+    for( dimmable = Dimmable_Pins; dimmable != 0; dimmable &= dimmable - 1 )
+    {
+        unsigned int pin = __builtin_ctz( dimmable );
+
+        if( Wanted_Levels[pin] != Levels[pin] )
+        {
+            GpioPwmWrite( pin, Wanted_Levels[pin] );
+            Levels[pin] = Wanted_Levels[pin];
+        }
+
+        Wanted_Levels[pin] = LED_LEVEL_OFF;
+    }
+}
+
+
+/* Turn every configured LED off, whatever state it is believed to be in */
+void LedsOff( void )
+{
+    for( uint32_t configured = Configured_Pins; configured != 0; configured &= configured - 1 )
+    {
+        unsigned int pin = __builtin_ctz( configured );
+
+        if( (Dimmable_Pins & PIN_BIT(pin)) != 0 )
+        {
+            GpioPwmWrite( pin, LED_LEVEL_OFF );
+            Levels[pin]        = LED_LEVEL_OFF;
+            Wanted_Levels[pin] = LED_LEVEL_OFF;
+        }
+        else
+        {
+            GpioWrite( pin, GPIO_LOW );
+        }
+    }
+
+    Pins_On     = 0;
+    Pins_Wanted = 0;
+}
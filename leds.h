@@ -0,0 +1,20 @@
+#ifndef _LEDS_H
+
+    #define _LEDS_H
+
+    #include <stdbool.h>
+
+    #define LEDS_MAX_PINS                     32
+    #define LED_LEVEL_OFF                     0
+    #define LED_LEVEL_FULL                    100
+
+    /* Every tick, each activity source calls LedsRequest() for the pins it wants lit, then
+     *  LedsUpdate() writes only the pins whose state differs from the previous tick. Several
+     *  sources may share one pin; the brightest request wins.
+     */
+    void LedsAddPin( unsigned int pin, bool dimmable );
+    void LedsRequest( unsigned int pin, unsigned int level );
+    void LedsUpdate( void );
+    void LedsOff( void );
+
+#endif
@@ -0,0 +1,257 @@
+/**************************************************************************
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ **************************************************************************/
+
+/**************************************************************************
+ * Build-time helper: reads the list of known /proc/vmstat counter names
+ *  and writes a C header holding a minimal-collision perfect hash table
+ *  for them (hash and displace). PiDiskLeds uses the table to look up
+ *  each vmstat line's key with two array reads and one string compare.
+ *
+ * Usage:
+ *   mkvmstatkeytable vmstatkeys.txt > vmstatkeytable.h
+ **************************************************************************/
+
+
+/* Using GNU extensions to ISO standards */
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "vmstathash.h"
+
+#define MAX_KEYS                          1024
+#define MAX_KEY_LENGTH                    255
+#define MAX_DISPLACEMENT                  65535
+
+
+static char*         Keys[MAX_KEYS];
+static size_t        Key_Lengths[MAX_KEYS];
+static uint32_t      Key_Hashes[MAX_KEYS];
+static size_t        Key_Count                 = 0;
+
+
+/* Smallest power of two not below value */
+static uint32_t NextPowerOfTwo( uint32_t value )
+{
+    uint32_t power = 1;
+
+    while( power < value )
+        power <<= 1;
+
+    return power;
+}
+
+
+static int ReadKeys( const char* file_name )
+{
+    FILE*   fp_keys            = fopen( file_name, "r" );
+    char*   line_buffer        = NULL;
+    size_t  line_buffer_size   = 0;
+    ssize_t line_length;
+
+    if( fp_keys == NULL )
+    {
+        perror( file_name );
+        return -1;
+    }
+
+    while( (line_length = getline(&line_buffer, &line_buffer_size, fp_keys)) != -1 )
+    {
+        while( (line_length > 0) && ((line_buffer[line_length - 1] == '\n') || (line_buffer[line_length - 1] == ' ')) )
+            line_buffer[--line_length] = '\0';
+
+        if( (line_length == 0) || (line_buffer[0] == '#') )
+            continue;
+
+        if( (Key_Count == MAX_KEYS) || (line_length > MAX_KEY_LENGTH) )
+        {
+            fprintf( stderr, "%s: too many keys, or key \"%s\" too long\n", file_name, line_buffer );
+            fclose( fp_keys );
+            return -1;
+        }
+
+        for( size_t key = 0; key < Key_Count; key++ )
+        {
+            if( strcmp(Keys[key], line_buffer) == 0 )
+            {
+                fprintf( stderr, "%s: duplicate key \"%s\"\n", file_name, line_buffer );
+                fclose( fp_keys );
+                return -1;
+            }
+        }
+
+        Keys[Key_Count]        = strdup( line_buffer );
+        Key_Lengths[Key_Count] = line_length;
+        Key_Hashes[Key_Count]  = VmStatHash( line_buffer, line_length );
+        Key_Count++;
+    }
+
+    free( line_buffer );
+    fclose( fp_keys );
+
+    return 0;
+}
+
+
+int main( int argc, char **argv )
+{
+    uint32_t  slot_count;
+    uint32_t  bucket_count;
+    uint32_t* displacements;
+    int*      slot_keys;
+    size_t*   bucket_sizes;
+    uint32_t* bucket_order;
+
+    if( argc != 2 )
+    {
+        fprintf( stderr, "Usage: %s KEYFILE\n", argv[0] );
+        return EXIT_FAILURE;
+    }
+
+    if( (ReadKeys(argv[1]) != 0) || (Key_Count == 0) )
+        return EXIT_FAILURE;
+
+    /* Load factor of 0.8 or below for the slots, about four keys per bucket */
+    slot_count    = NextPowerOfTwo( (Key_Count * 5 + 3) / 4 );
+    bucket_count  = NextPowerOfTwo( (Key_Count + 3) / 4 );
+
+    displacements = calloc( bucket_count, sizeof(*displacements) );
+    slot_keys     = malloc( slot_count * sizeof(*slot_keys) );
+    bucket_sizes  = calloc( bucket_count, sizeof(*bucket_sizes) );
+    bucket_order  = malloc( bucket_count * sizeof(*bucket_order) );
+    if( (displacements == NULL) || (slot_keys == NULL) || (bucket_sizes == NULL) || (bucket_order == NULL) )
+    {
+        perror( "Out of memory" );
+        return EXIT_FAILURE;
+    }
+
+    for( uint32_t slot = 0; slot < slot_count; slot++ )
+        slot_keys[slot] = -1;
+
+    for( size_t key = 0; key < Key_Count; key++ )
+        bucket_sizes[Key_Hashes[key] & (bucket_count - 1)]++;
+
+    /* Place the most crowded buckets first, while the table is still mostly empty */
+    for( uint32_t bucket = 0; bucket < bucket_count; bucket++ )
+    {
+        uint32_t position = bucket;
+
+        while( (position > 0) && (bucket_sizes[bucket_order[position - 1]] < bucket_sizes[bucket]) )
+        {
+            bucket_order[position] = bucket_order[position - 1];
+            position--;
+        }
+
+        bucket_order[position] = bucket;
+    }
+
+    for( uint32_t order = 0; order < bucket_count; order++ )
+    {
+        uint32_t bucket = bucket_order[order];
+        uint32_t displacement;
+
+        if( bucket_sizes[bucket] == 0 )
+            break;
+
+        for( displacement = 0; displacement <= MAX_DISPLACEMENT; displacement++ )
+        {
+            bool fits = true;
+
+            for( size_t key = 0; (key < Key_Count) && (fits == true); key++ )
+            {
+                uint32_t slot;
+
+                if( (Key_Hashes[key] & (bucket_count - 1)) != bucket )
+                    continue;
+
+                slot = VmStatHashSlot( Key_Hashes[key], displacement, slot_count - 1 );
+                if( slot_keys[slot] != -1 )
+                {
+                    fits = false;
+                }
+                else
+                {
+                    slot_keys[slot] = (int)key;
+                }
+            }
+
+            if( fits == true )
+                break;
+
+            /* Undo the partial placement of this bucket */
+            for( uint32_t slot = 0; slot < slot_count; slot++ )
+            {
+                if( (slot_keys[slot] != -1) && ((Key_Hashes[slot_keys[slot]] & (bucket_count - 1)) == bucket) )
+                    slot_keys[slot] = -1;
+            }
+        }
+
+        if( displacement > MAX_DISPLACEMENT )
+        {
+            fprintf( stderr, "%s: could not find a perfect hash for bucket %u\n", argv[0], bucket );
+            return EXIT_FAILURE;
+        }
+
+        displacements[bucket] = displacement;
+    }
+
+    printf( "/* Generated by mkvmstatkeytable from %s -- do not edit */\n\n", argv[1] );
+    printf( "#ifndef _VM_STAT_KEY_TABLE_H\n\n" );
+    printf( "    #define _VM_STAT_KEY_TABLE_H\n\n" );
+    printf( "    #include <stdint.h>\n\n" );
+    printf( "    #define VM_STAT_KNOWN_KEY_COUNT           %zu\n", Key_Count );
+    printf( "    #define VM_STAT_HASH_BUCKET_MASK          %uu\n", bucket_count - 1 );
+    printf( "    #define VM_STAT_HASH_SLOT_MASK            %uu\n\n", slot_count - 1 );
+
+    printf( "    static const uint16_t Vm_Stat_Hash_Displacements[%u] =\n    {", bucket_count );
+    for( uint32_t bucket = 0; bucket < bucket_count; bucket++ )
+        printf( "%s%u,", ((bucket % 12) == 0) ? "\n        " : " ", displacements[bucket] );
+    printf( "\n    };\n\n" );
+
+    printf( "    static const int16_t Vm_Stat_Hash_Slot_Keys[%u] =\n    {", slot_count );
+    for( uint32_t slot = 0; slot < slot_count; slot++ )
+        printf( "%s%d,", ((slot % 12) == 0) ? "\n        " : " ", slot_keys[slot] );
+    printf( "\n    };\n\n" );
+
+    printf( "    static const char* const Vm_Stat_Known_Keys[%zu] =\n    {\n", Key_Count );
+    for( size_t key = 0; key < Key_Count; key++ )
+        printf( "        \"%s\",\n", Keys[key] );
+    printf( "    };\n\n" );
+
+    printf( "    static const uint8_t Vm_Stat_Known_Key_Lengths[%zu] =\n    {", Key_Count );
+    for( size_t key = 0; key < Key_Count; key++ )
+        printf( "%s%zu,", ((key % 12) == 0) ? "\n        " : " ", Key_Lengths[key] );
+    printf( "\n    };\n\n" );
+
+    printf( "#endif\n" );
+
+    return EXIT_SUCCESS;
+}
@@ -7,11 +7,49 @@
     #define DEFAULT_RD_LED_GPIO_PIN           10             
     #define NUMERIC_OPTION_BASE               10
     #define MIN_POLL_TIME_MILLISECONDS        10
+    #define NANOSECONDS_PER_SECOND            1000000000ULL
     #define MIN_VALID_WR_PIN                  0
     #define MAX_VALID_WR_PIN                  29
     #define MIN_VALID_RD_PIN                  0
     #define MAX_VALID_RD_PIN                  29
+    #define MIN_VALID_MAP_PIN                 0
+    #define MAX_VALID_MAP_PIN                 29
+
+    #define MAX_COUNTER_MAPPINGS              16
+    #define MAX_COUNTER_NAME_LENGTH           63
+    #define DEFAULT_WR_COUNTER_NAME           "pgpgin"
+    #define DEFAULT_RD_COUNTER_NAME           "pgpgout"
+
+    #define RULE_CHANGED_NAME                 "changed"
+    #define RULE_RATE_ABOVE_NAME              "above"
+    #define RULE_BRIGHTNESS_NAME              "brightness"
+
+    #define MAX_DEVICE_MAPPINGS               8
+    #define MAX_WATCHED_DEVICES               32
+    #define MAX_DEVICE_NAME_LENGTH            31
+    #define BLOCK_DEVICE_DIRECTORY            "/sys/block"
+    #define BLOCK_DEVICE_STAT_FILE_NAME       "stat"
+    #define BLOCK_DEVICE_STAT_BUFFER_SIZE     256
+
+    #define MAX_PROCESS_MAPPINGS              8
+    #define MAX_WATCHED_PROCESSES             32
+    #define MAX_PROCESS_NAME_LENGTH           15             /* TASK_COMM_LEN - 1 */
+    #define PROC_DIRECTORY                    "/proc"
+    #define PROCESS_IO_FILE_NAME              "io"
+    #define PROCESS_COMM_FILE_NAME            "comm"
+    #define PROCESS_IO_BUFFER_SIZE            256
+    #define PROCESS_IO_READ_BYTES_KEY         "read_bytes"
+    #define PROCESS_IO_WRITE_BYTES_KEY        "write_bytes"
+    #define PROCESS_IO_SYSCR_KEY              "syscr"
+    #define PROCESS_IO_SYSCW_KEY              "syscw"
+    #define PROCESS_SYSCALLS_RULE_NAME        "syscalls"
+    #define PROCESS_EVENT_BUFFER_SIZE         8192
+    #define PROCESS_EVENT_SOCKET_BUFFER_SIZE  (1024 * 1024)
+    #define PROCESS_RESCAN_MILLISECONDS       5000
+    #define PROCESS_EVENTS_ACK_MILLISECONDS   250
 
     #define VM_STATS_FILE_NAME                "/proc/vmstat"
+    #define VM_STATS_BUFFER_SIZE              16384
+    #define VM_STATS_READ_SLACK               256
 
 #endif
@@ -4,6 +4,8 @@
 
     #include "macroasstring.h"
     #include "pidiskleds.h"
+    #include "ratehistogram.h"
+    #include "shiftregister.h"
 
     #define OPTION_DETACH_NAME                "detach"
     #define OPTION_DETACH_KEY                 'd'
@@ -27,6 +29,63 @@
     #define OPTION_WR_PIN_DOCUMENTATION       "GPIO pin number where disk write activity LED is connected\n"\
                                               "(Uses WiringPi numbering scheme. Default: WiringPi pin " MACRO_VALUE_AS_STRING(DEFAULT_WR_LED_GPIO_PIN) ")\n"
 
+    #define OPTION_MAP_NAME                   "map counter"
+    #define OPTION_MAP_KEY                    'm'
+    #define OPTION_MAP_ARG_TYPE               "COUNTER:RULE@PIN"
+    #define OPTION_MAP_DOCUMENTATION          "Light the LED on PIN from any /proc/vmstat COUNTER. RULE is \"" RULE_CHANGED_NAME "\" (counter changed), "\
+                                              "\"" RULE_RATE_ABOVE_NAME ":N\" (rate above N per second) or \"" RULE_BRIGHTNESS_NAME ":N\" (brightness "\
+                                              "follows the rate, full at N per second). May be repeated, up to " MACRO_VALUE_AS_STRING(MAX_COUNTER_MAPPINGS) " times\n"
+
+    #define OPTION_DEVICE_NAME                "block device"
+    #define OPTION_DEVICE_KEY                 'b'
+    #define OPTION_DEVICE_ARG_TYPE            "PATTERN@PIN"
+    #define OPTION_DEVICE_DOCUMENTATION       "Light the LED on PIN on read or write activity of the disks whose names match PATTERN "\
+                                              "(e.g. \"mmcblk0\" or \"sd*\"), including disks plugged in later. May be repeated, up to "\
+                                              MACRO_VALUE_AS_STRING(MAX_DEVICE_MAPPINGS) " times\n"
+
+    #define OPTION_PROCESS_NAME               "process"
+    #define OPTION_PROCESS_KEY                'P'
+    #define OPTION_PROCESS_ARG_TYPE           "PROCESS@PIN[:" PROCESS_SYSCALLS_RULE_NAME "]"
+    #define OPTION_PROCESS_DOCUMENTATION      "Light the LED on PIN when PROCESS, a PID or a process name pattern (e.g. \"pg_dump\"), reads "\
+                                              "from or writes to storage; with \":" PROCESS_SYSCALLS_RULE_NAME "\", on any read or write "\
+                                              "system call. Processes watched by name are found again when they restart. May be repeated, "\
+                                              "up to " MACRO_VALUE_AS_STRING(MAX_PROCESS_MAPPINGS) " times\n"
+
+    #define OPTION_UEVENT_SOCKET_NAME         "uevent socket"
+    #define OPTION_UEVENT_SOCKET_KEY          'u'
+    #define OPTION_UEVENT_SOCKET_ARG_TYPE     "PATH"
+    #define OPTION_UEVENT_SOCKET_DOCUMENTATION "Take disk hot-plug events from datagrams sent to a Unix socket created at PATH instead of "\
+                                              "from the kernel (for testing)\n"
+
+    #define OPTION_SIMULATE_NAME              "simulate"
+    #define OPTION_SIMULATE_KEY               'S'
+    #define OPTION_SIMULATE_ARG_TYPE          "VCDFILE"
+    #define OPTION_SIMULATE_DOCUMENTATION     "Do not drive any GPIO pins; record every pin change instead, write the recording to VCDFILE "\
+                                              "as a waveform and print a timing summary on exit (for testing)\n"
+
+    #define OPTION_STATS_FILE_NAME            "stats file"
+    #define OPTION_STATS_FILE_KEY             'f'
+    #define OPTION_STATS_FILE_ARG_TYPE        "FILE"
+    #define OPTION_STATS_FILE_DOCUMENTATION   "Read the statistics from FILE instead of " VM_STATS_FILE_NAME " (for testing)\n"
+
+    #define OPTION_RATE_REPORT_NAME           "rate report"
+    #define OPTION_RATE_REPORT_KEY            'h'
+    #define OPTION_RATE_REPORT_ARG_TYPE       "FILE"
+    #define OPTION_RATE_REPORT_DOCUMENTATION  "Keep histograms of the per-poll rates of the disk page in and out counters, and append one line of their "\
+                                              "percentiles (p50, p90, p99, max) per interval to FILE (\"" RATE_REPORT_STDOUT_NAME "\" for standard output)\n"
+
+    #define OPTION_REPORT_INTERVAL_NAME       "report interval"
+    #define OPTION_REPORT_INTERVAL_KEY        'H'
+    #define OPTION_REPORT_INTERVAL_ARG_TYPE   "SECONDS"
+    #define OPTION_REPORT_INTERVAL_DOCUMENTATION "Length of each rate report interval\n(Default: " MACRO_VALUE_AS_STRING(RATE_REPORT_DEFAULT_INTERVAL_SECONDS) " s)\n"
+
+    #define OPTION_BAR_GRAPH_NAME             "bar graph"
+    #define OPTION_BAR_GRAPH_KEY              'g'
+    #define OPTION_BAR_GRAPH_ARG_TYPE         "SEGMENTS:FULLSCALE@OUTPUT"
+    #define OPTION_BAR_GRAPH_DOCUMENTATION    "Show the disk page in/out rate as a bar graph of up to " MACRO_VALUE_AS_STRING(SHIFT_REGISTER_MAX_BITS) " SEGMENTS on "\
+                                              "chained 74HC595 shift registers (log scale, all lit at FULLSCALE pages per second). OUTPUT is "\
+                                              "either DATA,CLOCK,LATCH GPIO pins or an SPI device such as /dev/spidev0.0\n"
+
 
     #if (DEFAULT_RD_LED_GPIO_PIN == 10 ) || (DEFAULT_WR_LED_GPIO_PIN == 10)
         #define HELP_NOTE_PIN_10              "NOTE: The default GPIO pin (WiringPi pin 10, BCM GPIO pin 8, physical pin 24) is used for CE0 in "\
@@ -48,14 +107,36 @@
                                               "Indicates read and write activity for all mounted block devices (e.g. USB flash drive, USB disk drive, etc.) "\
                                               "in addition to the SD card by blinking one or two LEDs connected to GPIO pins.\n\n" HELP_NOTE_PIN_10 HELP_NOTE_PIN_11 \
                                               "To show the mapping of WiringPi pin numbers to physical pins on this Raspberry Pi, the \"gpio readall\" command "\
-                                              "may be used (requires the \"wiringpi\" package to be installed).\n\n"
+                                              "may be used (requires the \"wiringpi\" package to be installed).\n\n"\
+                                              "Examples of extra counters: pswpin/pswpout (swap traffic), workingset_refault_file (page cache "\
+                                              "thrashing), oom_kill (OOM killer), e.g. \"-m oom_kill:changed@5 -m pswpout:above:100@6\".\n\n"
 
-    #define VM_STATS_FILE_OPEN_ERROR_MSG      "Could not open " VM_STATS_FILE_NAME " for reading"
-    #define VM_STATS_FILE_SEEK_ERROR_MSG      "Could not return to start of " VM_STATS_FILE_NAME
-    #define FILE_BUFFER_FLUSH_ERROR_MSG       "Could not clear out file buffer"
+    #define VM_STATS_FILE_READ_ERROR_MSG      "Could not read " VM_STATS_FILE_NAME
+    #define COUNTER_NOT_FOUND_MSG             "Counter not found in " VM_STATS_FILE_NAME ", its LED will stay off"
     #define DETACH_FAILURE_MSG                "Could not detach from terminal"
     #define INVALID_POLL_TIME_OPTION_MESSAGE  "poll time interval must be at least " MACRO_VALUE_AS_STRING(MIN_POLL_TIME_MILLISECONDS) " milliseconds"
     #define INVALID_WR_PIN_OPTION_MESSAGE     "pin number must be between " MACRO_VALUE_AS_STRING(MIN_VALID_WR_PIN) " and " MACRO_VALUE_AS_STRING(MAX_VALID_WR_PIN)
     #define INVALID_RD_PIN_OPTION_MESSAGE     "pin number must be between " MACRO_VALUE_AS_STRING(MIN_VALID_RD_PIN) " and " MACRO_VALUE_AS_STRING(MAX_VALID_RD_PIN)
+    #define INVALID_MAP_OPTION_MESSAGE        "counter mapping must look like COUNTER:" RULE_CHANGED_NAME "@PIN, COUNTER:" RULE_RATE_ABOVE_NAME ":N@PIN or "\
+                                              "COUNTER:" RULE_BRIGHTNESS_NAME ":N@PIN, with N greater than zero and PIN between "\
+                                              MACRO_VALUE_AS_STRING(MIN_VALID_MAP_PIN) " and " MACRO_VALUE_AS_STRING(MAX_VALID_MAP_PIN)
+    #define INVALID_REPORT_INTERVAL_MESSAGE   "rate report interval must be between " MACRO_VALUE_AS_STRING(RATE_REPORT_MIN_INTERVAL_SECONDS) " and "\
+                                              MACRO_VALUE_AS_STRING(RATE_REPORT_MAX_INTERVAL_SECONDS) " seconds"
+    #define INVALID_BAR_GRAPH_OPTION_MESSAGE  "bar graph must look like SEGMENTS:FULLSCALE@DATA,CLOCK,LATCH or SEGMENTS:FULLSCALE@/dev/spidevB.C, "\
+                                              "with 1 to " MACRO_VALUE_AS_STRING(SHIFT_REGISTER_MAX_BITS) " segments and pins between "\
+                                              MACRO_VALUE_AS_STRING(SHIFT_REGISTER_MIN_VALID_PIN) " and " MACRO_VALUE_AS_STRING(SHIFT_REGISTER_MAX_VALID_PIN)
+    #define INVALID_DEVICE_OPTION_MESSAGE     "block device mapping must look like PATTERN@PIN, with PIN between "\
+                                              MACRO_VALUE_AS_STRING(MIN_VALID_MAP_PIN) " and " MACRO_VALUE_AS_STRING(MAX_VALID_MAP_PIN) \
+                                              ", and may be given at most " MACRO_VALUE_AS_STRING(MAX_DEVICE_MAPPINGS) " times"
+    #define INVALID_PROCESS_OPTION_MESSAGE    "process mapping must look like PID@PIN or NAME@PIN, optionally followed by \":"\
+                                              PROCESS_SYSCALLS_RULE_NAME "\", with a NAME of at most " MACRO_VALUE_AS_STRING(MAX_PROCESS_NAME_LENGTH) \
+                                              " characters, PIN between " MACRO_VALUE_AS_STRING(MIN_VALID_MAP_PIN) " and " MACRO_VALUE_AS_STRING(MAX_VALID_MAP_PIN) \
+                                              ", and given at most " MACRO_VALUE_AS_STRING(MAX_PROCESS_MAPPINGS) " times"
+    #define PROCESS_NOT_FOUND_MSG             "Process not found, its LED will stay off"
+    #define PROCESS_EPOLL_ERROR_MSG           "Could not create the epoll set for process exits"
+    #define PROCESS_EVENTS_UNAVAILABLE_MSG    "No process events (needs CAP_NET_ADMIN), looking for restarted processes every "\
+                                              MACRO_VALUE_AS_STRING(PROCESS_RESCAN_MILLISECONDS) " ms instead"
+    #define PROCESS_EVENTS_READ_ERROR_MSG     "Could not read process events"
+    #define TOO_MANY_MAPS_OPTION_MESSAGE      "at most " MACRO_VALUE_AS_STRING(MAX_COUNTER_MAPPINGS) " counter mappings may be given"
 
 #endif
\ No newline at end of file
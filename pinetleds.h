@@ -7,12 +7,58 @@
     #define DEFAULT_RX_LED_GPIO_PIN           11             
     #define NUMERIC_OPTION_BASE               10
     #define MIN_POLL_TIME_MILLISECONDS        10
+    #define NANOSECONDS_PER_SECOND            1000000000ULL
     #define MIN_VALID_TX_PIN                  0
     #define MAX_VALID_TX_PIN                  29
     #define MIN_VALID_RX_PIN                  0
     #define MAX_VALID_RX_PIN                  29
+    #define MIN_VALID_MAP_PIN                 0
+    #define MAX_VALID_MAP_PIN                 29
 
     #define NETWORK_STATS_FILE_NAME           "/proc/net/dev"
     #define DEFAULT_NET_LOOPBACK_DEVICE_NAME  "lo:"
+    #define NET_LOOPBACK_INTERFACE_NAME       "lo"
+
+    /* Rate report histograms */
+    #define RATE_REPORT_RX_SOURCE             0
+    #define RATE_REPORT_TX_SOURCE             1
+    #define RATE_REPORT_RX_SOURCE_NAME        "rx"
+    #define RATE_REPORT_TX_SOURCE_NAME        "tx"
+
+    /* Per-interface LEDs, fed from sysfs and kept up to date by hot-plug events */
+    #define MAX_INTERFACE_MAPPINGS            8
+    #define MAX_WATCHED_INTERFACES            32
+    #define NET_CLASS_DIRECTORY               "/sys/class/net"
+    #define NET_STATISTICS_DIRECTORY          "statistics"
+    #define NET_RX_PACKETS_FILE_NAME          "rx_packets"
+    #define NET_TX_PACKETS_FILE_NAME          "tx_packets"
+    #define NET_COUNTER_BUFFER_SIZE           32
+
+    /* Other network namespaces, read through a /proc/net/dev opened inside each */
+    #define MAX_NAMESPACES                    16
+    #define NAMESPACE_STATS_FILE_NAME         "/proc/thread-self/net/dev"
+    #define NAMESPACE_STATS_BUFFER_SIZE       16384          /* To start with; grows to fit */
+    #define NET_DEV_RX_PACKETS_FIELD          1
+    #define NET_DEV_TX_PACKETS_FIELD          9
+
+    /* rtnetlink link monitor: polling stops while no interface (other than loopback) is up */
+    #define MAX_INTERFACES                    64
+    #define LINK_EVENT_BUFFER_SIZE            8192
+    #define LINK_DUMP_TIMEOUT_MILLISECONDS    1000
+
+    /* AF_PACKET TPACKET_V3 capture ring (--packet capture). Only the packet headers are needed,
+     *  and the kernel only wakes us when a block is retired with packets in it, so an idle
+     *  link costs nothing in user space. A block that is not full is retired when the block
+     *  retire timeout (--capture latency) runs out, which bounds how late a sparse packet shows.
+     *  The kernel's retire timer keeps firing once per timeout while the ring is open, though,
+     *  even on an idle link: 1 ms means a thousand kernel timer runs a second.
+     */
+    #define PACKET_RING_SNAPLEN               16
+    #define PACKET_RING_BLOCK_COUNT           16
+    #define PACKET_RING_FRAME_SIZE            128
+    #define DEFAULT_CAPTURE_LATENCY_MILLISECONDS  1
+    #define MIN_CAPTURE_LATENCY_MILLISECONDS  1
+    #define MAX_CAPTURE_LATENCY_MILLISECONDS  1000
+    #define PACKET_RING_REOPEN_MILLISECONDS   1000           /* While the captured interface is gone */
 
 #endif
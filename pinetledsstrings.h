@@ -4,6 +4,8 @@
 
     #include "macroasstring.h"
     #include "pinetleds.h"
+    #include "ratehistogram.h"
+    #include "shiftregister.h"
 
     #define OPTION_DETACH_NAME                "detach"
     #define OPTION_DETACH_KEY                 'd'
@@ -27,6 +29,68 @@
     #define OPTION_TX_PIN_DOCUMENTATION       "GPIO pin number where transmit activity LED is connected\n"\
                                               "(Uses WiringPi numbering scheme. Default: WiringPi pin " MACRO_VALUE_AS_STRING(DEFAULT_TX_LED_GPIO_PIN) ")\n"
 
+    #define OPTION_CAPTURE_NAME               "packet capture"
+    #define OPTION_CAPTURE_KEY                'c'
+    #define OPTION_CAPTURE_ARG_TYPE           "INTERFACE"
+    #define OPTION_CAPTURE_DOCUMENTATION      "Blink on each packet as it arrives, using a packet capture ring instead of polling "\
+                                              NETWORK_STATS_FILE_NAME ". Without INTERFACE, all interfaces except loopback are watched\n"
+
+    #define OPTION_CAPTURE_LATENCY_NAME       "capture latency"
+    #define OPTION_CAPTURE_LATENCY_KEY        'l'
+    #define OPTION_CAPTURE_LATENCY_ARG_TYPE   "MILLISECONDS"
+    #define OPTION_CAPTURE_LATENCY_DOCUMENTATION "With --" OPTION_CAPTURE_NAME ", the longest a packet may wait before the LEDs show it. "\
+                                              "Shorter costs more kernel timer runs, even while the link is idle\n"\
+                                              "(Default: " MACRO_VALUE_AS_STRING(DEFAULT_CAPTURE_LATENCY_MILLISECONDS) " ms)\n"
+
+    #define OPTION_INTERFACE_NAME             "interface"
+    #define OPTION_INTERFACE_KEY              'i'
+    #define OPTION_INTERFACE_ARG_TYPE         "PATTERN@PIN"
+    #define OPTION_INTERFACE_DOCUMENTATION    "Light the LED on PIN on receive or transmit activity of the interfaces whose names match "\
+                                              "PATTERN (e.g. \"eth0\" or \"wlan*\"), including interfaces plugged in later. Not used with --"\
+                                              OPTION_CAPTURE_NAME ". May be repeated, up to " MACRO_VALUE_AS_STRING(MAX_INTERFACE_MAPPINGS) " times\n"
+
+    #define OPTION_NAMESPACE_NAME             "namespace"
+    #define OPTION_NAMESPACE_KEY              'n'
+    #define OPTION_NAMESPACE_ARG_TYPE         "NSPATH[@PIN]"
+    #define OPTION_NAMESPACE_DOCUMENTATION    "Also count the packets of the network namespace NSPATH (e.g. /run/netns/NAME or /proc/PID/ns/net), "\
+                                              "on the LED on PIN if given, otherwise on the receive and transmit LEDs. Not used with --"\
+                                              OPTION_CAPTURE_NAME ". May be repeated, up to " MACRO_VALUE_AS_STRING(MAX_NAMESPACES) " times\n"
+
+    #define OPTION_UEVENT_SOCKET_NAME         "uevent socket"
+    #define OPTION_UEVENT_SOCKET_KEY          'u'
+    #define OPTION_UEVENT_SOCKET_ARG_TYPE     "PATH"
+    #define OPTION_UEVENT_SOCKET_DOCUMENTATION "Take interface hot-plug events from datagrams sent to a Unix socket created at PATH instead of "\
+                                              "from the kernel (for testing)\n"
+
+    #define OPTION_SIMULATE_NAME              "simulate"
+    #define OPTION_SIMULATE_KEY               'S'
+    #define OPTION_SIMULATE_ARG_TYPE          "VCDFILE"
+    #define OPTION_SIMULATE_DOCUMENTATION     "Do not drive any GPIO pins; record every pin change instead, write the recording to VCDFILE "\
+                                              "as a waveform and print a timing summary on exit (for testing)\n"
+
+    #define OPTION_STATS_FILE_NAME            "stats file"
+    #define OPTION_STATS_FILE_KEY             'f'
+    #define OPTION_STATS_FILE_ARG_TYPE        "FILE"
+    #define OPTION_STATS_FILE_DOCUMENTATION   "Read the statistics from FILE instead of " NETWORK_STATS_FILE_NAME " (for testing)\n"
+
+    #define OPTION_RATE_REPORT_NAME           "rate report"
+    #define OPTION_RATE_REPORT_KEY            'h'
+    #define OPTION_RATE_REPORT_ARG_TYPE       "FILE"
+    #define OPTION_RATE_REPORT_DOCUMENTATION  "Keep histograms of the per-poll rates of packets received and transmitted, and append one line of their "\
+                                              "percentiles (p50, p90, p99, max) per interval to FILE (\"" RATE_REPORT_STDOUT_NAME "\" for standard output)\n"
+
+    #define OPTION_REPORT_INTERVAL_NAME       "report interval"
+    #define OPTION_REPORT_INTERVAL_KEY        'H'
+    #define OPTION_REPORT_INTERVAL_ARG_TYPE   "SECONDS"
+    #define OPTION_REPORT_INTERVAL_DOCUMENTATION "Length of each rate report interval\n(Default: " MACRO_VALUE_AS_STRING(RATE_REPORT_DEFAULT_INTERVAL_SECONDS) " s)\n"
+
+    #define OPTION_BAR_GRAPH_NAME             "bar graph"
+    #define OPTION_BAR_GRAPH_KEY              'g'
+    #define OPTION_BAR_GRAPH_ARG_TYPE         "SEGMENTS:FULLSCALE@OUTPUT"
+    #define OPTION_BAR_GRAPH_DOCUMENTATION    "Show the packet rate as a bar graph of up to " MACRO_VALUE_AS_STRING(SHIFT_REGISTER_MAX_BITS) " SEGMENTS on "\
+                                              "chained 74HC595 shift registers (log scale, all lit at FULLSCALE packets per second). OUTPUT is "\
+                                              "either DATA,CLOCK,LATCH GPIO pins or an SPI device such as /dev/spidev0.0\n"
+
 
     #if (DEFAULT_RX_LED_GPIO_PIN == 10 ) || (DEFAULT_TX_LED_GPIO_PIN == 10)
         #define HELP_NOTE_PIN_10              "NOTE: The default GPIO pin (WiringPi pin 10, BCM GPIO pin 8, physical pin 24) is used for CE0 in "\
@@ -50,12 +114,28 @@
                                               "To show the mapping of WiringPi pin numbers to physical pins on this Raspberry Pi, the \"gpio readall\" command "\
                                               "may be used (requires the \"wiringpi\" package to be installed).\n\n"
 
-    #define NETWORK_STATS_FILE_OPEN_ERROR_MSG "Could not open " NETWORK_STATS_FILE_NAME " for reading"
     #define NETWORK_STATS_FILE_SEEK_ERROR_MSG "Could not return to start of " NETWORK_STATS_FILE_NAME
     #define FILE_BUFFER_FLUSH_ERROR_MSG       "Could not clear out file buffer"
+    #define PACKET_RING_OPEN_ERROR_MSG        "Could not set up the packet capture ring"
+    #define PACKET_RING_POLL_ERROR_MSG        "Could not wait for packets"
+    #define UNKNOWN_INTERFACE_ERROR_MSG       "Unknown network interface"
+    #define LINK_MONITOR_READ_ERROR_MSG       "Could not read link notifications"
     #define DETACH_FAILURE_MSG                "Could not detach from terminal"
     #define INVALID_POLL_TIME_OPTION_MESSAGE  "poll time interval must be at least " MACRO_VALUE_AS_STRING(MIN_POLL_TIME_MILLISECONDS) " milliseconds"
+    #define INVALID_CAPTURE_LATENCY_MESSAGE   "capture latency must be between " MACRO_VALUE_AS_STRING(MIN_CAPTURE_LATENCY_MILLISECONDS) " and "\
+                                              MACRO_VALUE_AS_STRING(MAX_CAPTURE_LATENCY_MILLISECONDS) " milliseconds"
     #define INVALID_TX_PIN_OPTION_MESSAGE     "pin number must be between " MACRO_VALUE_AS_STRING(MIN_VALID_TX_PIN) " and " MACRO_VALUE_AS_STRING(MAX_VALID_TX_PIN)
+    #define INVALID_REPORT_INTERVAL_MESSAGE   "rate report interval must be between " MACRO_VALUE_AS_STRING(RATE_REPORT_MIN_INTERVAL_SECONDS) " and "\
+                                              MACRO_VALUE_AS_STRING(RATE_REPORT_MAX_INTERVAL_SECONDS) " seconds"
+    #define INVALID_BAR_GRAPH_OPTION_MESSAGE  "bar graph must look like SEGMENTS:FULLSCALE@DATA,CLOCK,LATCH or SEGMENTS:FULLSCALE@/dev/spidevB.C, "\
+                                              "with 1 to " MACRO_VALUE_AS_STRING(SHIFT_REGISTER_MAX_BITS) " segments and pins between "\
+                                              MACRO_VALUE_AS_STRING(SHIFT_REGISTER_MIN_VALID_PIN) " and " MACRO_VALUE_AS_STRING(SHIFT_REGISTER_MAX_VALID_PIN)
+    #define INVALID_INTERFACE_OPTION_MESSAGE  "interface mapping must look like PATTERN@PIN, with PIN between "\
+                                              MACRO_VALUE_AS_STRING(MIN_VALID_MAP_PIN) " and " MACRO_VALUE_AS_STRING(MAX_VALID_MAP_PIN) \
+                                              ", and may be given at most " MACRO_VALUE_AS_STRING(MAX_INTERFACE_MAPPINGS) " times"
+    #define INVALID_NAMESPACE_OPTION_MESSAGE  "namespace must look like NSPATH or NSPATH@PIN, with PIN between "\
+                                              MACRO_VALUE_AS_STRING(MIN_VALID_MAP_PIN) " and " MACRO_VALUE_AS_STRING(MAX_VALID_MAP_PIN) \
+                                              ", and may be given at most " MACRO_VALUE_AS_STRING(MAX_NAMESPACES) " times"
     #define INVALID_RX_PIN_OPTION_MESSAGE     "pin number must be between " MACRO_VALUE_AS_STRING(MIN_VALID_RX_PIN) " and " MACRO_VALUE_AS_STRING(MAX_VALID_RX_PIN)
 
 #endif
\ No newline at end of file
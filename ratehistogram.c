@@ -0,0 +1,239 @@
+/**************************************************************************
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ **************************************************************************/
+
+/**************************************************************************
+ * Streaming rate histograms, shared by PiDiskLeds and PiNetLeds.
+ *
+ * Every tick the daemon records the rate each source saw over that tick.
+ *  Once per interval the percentiles of every source are written out as
+ *  one line, e.g.
+ *
+ *   2026-10-18T14:00:00+0200 3600 read:n=180000,p50=0,p90=12,p99=1030,max=8191 write:n=...
+ *
+ *  (start of the interval, its length in seconds, then for each source the
+ *  number of ticks and the 50th/90th/99th percentile and highest rate per
+ *  second) and the histograms start again from empty.
+ **************************************************************************/
+
+
+/* Using GNU extensions to ISO standards */
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "ratehistogram.h"
+
+#define NANOSECONDS_PER_SECOND            1000000000LL
+#define REPORT_TIME_FORMAT                "%Y-%m-%dT%H:%M:%S%z"
+
+
+/* Highest rate that falls in the same counts slot as the lowest one */
+static uint64_t HighestEquivalentValue( unsigned int index )
+{
+    int          bucket_index     = (int)(index >> RATE_HISTOGRAM_SUB_BUCKET_HALF_COUNT_MAGNITUDE) - 1;
+    unsigned int sub_bucket_index = (index & (RATE_HISTOGRAM_SUB_BUCKET_HALF_COUNT - 1)) + RATE_HISTOGRAM_SUB_BUCKET_HALF_COUNT;
+
+    if( bucket_index < 0 )
+    {
+        sub_bucket_index -= RATE_HISTOGRAM_SUB_BUCKET_HALF_COUNT;
+        bucket_index      = 0;
+    }
+
+    return ((uint64_t)sub_bucket_index << bucket_index) + (1ull << bucket_index) - 1;
+}
+
+
+/* The rate that permille thousandths of the samples did not exceed (to within the histogram's precision) */
+uint64_t RateHistogramValueAtPermille( const struct rate_histogram* histogram, unsigned int permille )
+{
+    uint64_t wanted = ((histogram->total_count * permille) + 999) / 1000;
+    uint64_t seen   = 0;
+
+    if( wanted == 0 )
+        wanted = 1;
+
+    for( unsigned int index = 0; index < RATE_HISTOGRAM_COUNTS_LENGTH; index++ )
+    {
+        seen += histogram->counts[index];
+        if( seen >= wanted )
+        {
+            uint64_t value = HighestEquivalentValue( index );
+
+            return (value < histogram->max_value) ? value : histogram->max_value;
+        }
+    }
+
+    return histogram->max_value;
+}
+
+
+/* Open FILE for appending, or use standard output for "-" */
+int RateReportOpen( struct rate_report* report, const char* file_name, unsigned int interval_seconds )
+{
+    memset( report, 0, sizeof(*report) );
+
+    report->interval_seconds = interval_seconds;
+
+    if( strcmp(file_name, RATE_REPORT_STDOUT_NAME) == 0 )
+    {
+        report->output = stdout;
+        return 0;
+    }
+
+    report->output = fopen( file_name, "ae" );
+    if( report->output == NULL )
+    {
+        perror( file_name );
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/* Add a histogram; the name heads its part of each report line */
+unsigned int RateReportAddSource( struct rate_report* report, const char* name )
+{
+    unsigned int source = report->source_count++;
+
+    report->sources[source].name = name;
+
+    return source;
+}
+
+
+/* Begin an interval now */
+void RateReportStart( struct rate_report* report, const struct timespec* now )
+{
+    for( unsigned int source = 0; source < report->source_count; source++ )
+    {
+        struct rate_histogram* histogram = &report->sources[source];
+
+        memset( histogram->counts, 0, sizeof(histogram->counts) );
+        histogram->total_count = 0;
+        histogram->max_value   = 0;
+    }
+
+    report->interval_start_time = time( NULL );
+    report->interval_start      = *now;
+    report->rotate_at           = *now;
+    report->rotate_at.tv_sec   += report->interval_seconds;
+}
+
+
+/* Record a span without polls as that many polls at a rate of 0 in every histogram. The part of
+ *  the span short of a whole poll is added to the next span rather than dropped */
+void RateReportRecordQuiet( struct rate_report* report, unsigned long long elapsed_nanoseconds, unsigned long long poll_nanoseconds )
+{
+    uint32_t polls;
+
+    elapsed_nanoseconds      += report->quiet_nanoseconds;
+    polls                     = elapsed_nanoseconds / poll_nanoseconds;
+    report->quiet_nanoseconds = elapsed_nanoseconds % poll_nanoseconds;
+
+    if( polls == 0 )
+        return;
+
+    for( unsigned int source = 0; source < report->source_count; source++ )
+        RateHistogramRecordCount( &report->sources[source], 0, polls );
+}
+
+
+static int WriteReportLine( struct rate_report* report, const struct timespec* now )
+{
+    long long  seconds = ((((now->tv_sec - report->interval_start.tv_sec) * NANOSECONDS_PER_SECOND) + now->tv_nsec - report->interval_start.tv_nsec) + (NANOSECONDS_PER_SECOND / 2)) / NANOSECONDS_PER_SECOND;
+    char       start_text[32];
+    struct tm  start_tm;
+
+    localtime_r( &report->interval_start_time, &start_tm );
+    strftime( start_text, sizeof(start_text), REPORT_TIME_FORMAT, &start_tm );
+
+    fprintf( report->output, "%s %lld", start_text, seconds );
+
+    for( unsigned int source = 0; source < report->source_count; source++ )
+    {
+        const struct rate_histogram* histogram = &report->sources[source];
+
+        fprintf( report->output, " %s:n=%llu,p50=%llu,p90=%llu,p99=%llu,max=%llu",
+                 histogram->name,
+                 (unsigned long long)histogram->total_count,
+                 (unsigned long long)RateHistogramValueAtPermille(histogram, 500),
+                 (unsigned long long)RateHistogramValueAtPermille(histogram, 900),
+                 (unsigned long long)RateHistogramValueAtPermille(histogram, 990),
+                 (unsigned long long)histogram->max_value );
+    }
+
+    fputc( '\n', report->output );
+
+    if( (fflush(report->output) != 0) || (ferror(report->output) != 0) )
+    {
+        perror( RATE_REPORT_WRITE_ERROR_MSG );
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/* Write out and clear the histograms if the interval is over */
+int RateReportTick( struct rate_report* report, const struct timespec* now )
+{
+    if( (now->tv_sec < report->rotate_at.tv_sec) || ((now->tv_sec == report->rotate_at.tv_sec) && (now->tv_nsec < report->rotate_at.tv_nsec)) )
+        return 0;
+
+    if( WriteReportLine(report, now) != 0 )
+        return -1;
+
+    RateReportStart( report, now );
+
+    return 0;
+}
+
+
+/* Write out the part of the interval gone by, if anything was recorded, and close the file */
+int RateReportClose( struct rate_report* report, const struct timespec* now )
+{
+    int result = 0;
+
+    if( report->output == NULL )
+        return 0;
+
+    if( (report->source_count > 0) && (report->sources[0].total_count > 0) )
+        result = WriteReportLine( report, now );
+
+    if( report->output != stdout )
+        fclose( report->output );
+
+    report->output = NULL;
+
+    return result;
+}
@@ -0,0 +1,85 @@
+#ifndef _RATE_HISTOGRAM_H
+
+    #define _RATE_HISTOGRAM_H
+
+    #include <stdbool.h>
+    #include <stdint.h>
+    #include <stdio.h>
+    #include <time.h>
+
+    /* HDR-style log/linear buckets: every power of two is split into 128 linear sub-buckets,
+     *  so a recorded rate is kept to within 1% (two significant digits) from 1 up to 2^36
+     *  per second. The counts take a fixed 15 KiB per source, whatever the rates seen.
+     */
+    #define RATE_HISTOGRAM_SUB_BUCKET_HALF_COUNT_MAGNITUDE  7
+    #define RATE_HISTOGRAM_SUB_BUCKET_HALF_COUNT            (1u << RATE_HISTOGRAM_SUB_BUCKET_HALF_COUNT_MAGNITUDE)
+    #define RATE_HISTOGRAM_SUB_BUCKET_MASK                  ((2ull << RATE_HISTOGRAM_SUB_BUCKET_HALF_COUNT_MAGNITUDE) - 1)
+    #define RATE_HISTOGRAM_MAX_VALUE_MAGNITUDE              36
+    #define RATE_HISTOGRAM_MAX_VALUE                        ((1ull << RATE_HISTOGRAM_MAX_VALUE_MAGNITUDE) - 1)
+    #define RATE_HISTOGRAM_BUCKET_COUNT                     (RATE_HISTOGRAM_MAX_VALUE_MAGNITUDE - RATE_HISTOGRAM_SUB_BUCKET_HALF_COUNT_MAGNITUDE)
+    #define RATE_HISTOGRAM_COUNTS_LENGTH                    ((RATE_HISTOGRAM_BUCKET_COUNT + 1) * RATE_HISTOGRAM_SUB_BUCKET_HALF_COUNT)
+
+    #define RATE_REPORT_MAX_SOURCES                         4
+    #define RATE_REPORT_MIN_INTERVAL_SECONDS                1
+    #define RATE_REPORT_MAX_INTERVAL_SECONDS                2678400     /* 31 days, so a count cannot overflow even at 1000 ticks per second */
+    #define RATE_REPORT_DEFAULT_INTERVAL_SECONDS            3600
+    #define RATE_REPORT_STDOUT_NAME                         "-"
+    #define RATE_REPORT_WRITE_ERROR_MSG                     "Could not write the rate report"
+
+    struct rate_histogram
+    {
+        const char*  name;
+        uint64_t     total_count;
+        uint64_t     max_value;
+        uint32_t     counts[RATE_HISTOGRAM_COUNTS_LENGTH];
+    };
+
+    /* A set of histograms, written out as one line and cleared every interval */
+    struct rate_report
+    {
+        FILE*                 output;
+        unsigned int          interval_seconds;
+        time_t                interval_start_time;         /* Wall clock, for the report line */
+        struct timespec       interval_start;              /* CLOCK_MONOTONIC */
+        struct timespec       rotate_at;                   /* CLOCK_MONOTONIC */
+        unsigned int          source_count;
+        struct rate_histogram sources[RATE_REPORT_MAX_SOURCES];
+        unsigned long long    quiet_nanoseconds;           /* Quiet time short of a whole poll, for the next span */
+    };
+
+    /* Index of the counts slot that a value falls in. A handful of integer operations */
+    static inline unsigned int RateHistogramIndex( uint64_t value )
+    {
+        int          bucket_index     = (64 - __builtin_clzll(value | RATE_HISTOGRAM_SUB_BUCKET_MASK)) - (RATE_HISTOGRAM_SUB_BUCKET_HALF_COUNT_MAGNITUDE + 1);
+        unsigned int sub_bucket_index = value >> bucket_index;
+
+        return ((bucket_index + 1) << RATE_HISTOGRAM_SUB_BUCKET_HALF_COUNT_MAGNITUDE) + (sub_bucket_index - RATE_HISTOGRAM_SUB_BUCKET_HALF_COUNT);
+    }
+
+    /* Record count samples of one rate. Nothing is allocated */
+    static inline void RateHistogramRecordCount( struct rate_histogram* histogram, uint64_t value, uint32_t count )
+    {
+        if( value > RATE_HISTOGRAM_MAX_VALUE )
+            value = RATE_HISTOGRAM_MAX_VALUE;
+
+        histogram->counts[RateHistogramIndex(value)] += count;
+        histogram->total_count                       += count;
+
+        if( value > histogram->max_value )
+            histogram->max_value = value;
+    }
+
+    static inline void RateHistogramRecord( struct rate_histogram* histogram, uint64_t value )
+    {
+        RateHistogramRecordCount( histogram, value, 1 );
+    }
+
+    uint64_t      RateHistogramValueAtPermille( const struct rate_histogram* histogram, unsigned int permille );
+    int           RateReportOpen( struct rate_report* report, const char* file_name, unsigned int interval_seconds );
+    unsigned int  RateReportAddSource( struct rate_report* report, const char* name );
+    void          RateReportStart( struct rate_report* report, const struct timespec* now );
+    void          RateReportRecordQuiet( struct rate_report* report, unsigned long long elapsed_nanoseconds, unsigned long long poll_nanoseconds );
+    int           RateReportTick( struct rate_report* report, const struct timespec* now );
+    int           RateReportClose( struct rate_report* report, const struct timespec* now );
+
+#endif
@@ -0,0 +1,248 @@
+/**************************************************************************
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ **************************************************************************/
+
+/**************************************************************************
+ * Shift register (74HC595) output and bar graph rendering, shared by
+ *  PiDiskLeds and PiNetLeds.
+ *
+ * Each tick the daemon renders a whole frame; the frame is only shifted
+ *  out when it differs from the one the registers already hold. The data
+ *  pin is only written when the next bit differs from the previous one, so
+ *  a 32-bit frame takes at most 98 pin writes.
+ *
+ * GPIO pin (SER)   ----> 74HC595 DS    Q7' ----> DS of the next 74HC595
+ * GPIO pin (SRCLK) ----> 74HC595 SHCP (all registers of the chain)
+ * GPIO pin (RCLK)  ----> 74HC595 STCP (all registers of the chain)
+ **************************************************************************/
+
+
+/* Using GNU extensions to ISO standards */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/ioctl.h>
+#include <linux/spi/spidev.h>
+
+#include "gpio.h"
+#include "shiftregister.h"
+
+/* log2 with 4 fractional bits, so a bar graph of many segments still moves smoothly */
+#define LOG2_FRACTION_BITS                4
+
+
+static bool ParsePin( const char* text, char** p_end, unsigned int* p_pin )
+{
+    long pin = strtol( text, p_end, 10 );
+
+    if( (*p_end == text) || (pin < SHIFT_REGISTER_MIN_VALID_PIN) || (pin > SHIFT_REGISTER_MAX_VALID_PIN) )
+        return false;
+
+    *p_pin = pin;
+
+    return true;
+}
+
+
+/* Parse "SEGMENTS:FULLSCALE@DATA,CLOCK,LATCH" or "SEGMENTS:FULLSCALE@/dev/spidevB.C" */
+bool BarGraphParse( const char* spec, struct bar_graph* graph )
+{
+    const char*   output = strchr( spec, '@' );
+    char*         end;
+    unsigned long segments;
+
+    memset( graph, 0, sizeof(*graph) );
+    graph->output.spi_fd = -1;
+
+    segments = strtoul( spec, &end, 10 );
+    if( (end == spec) || (*end != ':') || (segments == 0) || (segments > SHIFT_REGISTER_MAX_BITS) || (output == NULL) )
+        return false;
+
+    graph->segments   = segments;
+    graph->full_scale = strtoull( end + 1, &end, 10 );
+    if( (end != output) || (graph->full_scale == 0) || (graph->full_scale == ULLONG_MAX) )
+        return false;
+
+    graph->output.bits = (segments + 7) & ~7u;
+    output++;
+
+    if( strncmp(output, SHIFT_REGISTER_SPI_PREFIX, strlen(SHIFT_REGISTER_SPI_PREFIX)) == 0 )
+    {
+        if( strlen(output) >= sizeof(graph->output.spi_device) )
+            return false;
+
+        graph->output.use_spi = true;
+        strcpy( graph->output.spi_device, output );
+
+        return true;
+    }
+
+    return ParsePin( output, &end, &graph->output.data_pin ) && (*end == ',')
+        && ParsePin( end + 1, &end, &graph->output.clock_pin ) && (*end == ',')
+        && ParsePin( end + 1, &end, &graph->output.latch_pin ) && (*end == '\0');
+}
+
+
+int ShiftRegisterOpen( struct shift_register* output )
+{
+    output->frame_valid = false;
+
+    if( output->use_spi == true )
+    {
+        uint8_t  mode  = SPI_MODE_0;
+        uint8_t  bits  = 8;
+        uint32_t speed = SHIFT_REGISTER_SPI_SPEED_HZ;
+
+        output->spi_fd = open( output->spi_device, O_WRONLY | O_CLOEXEC );
+        if( (output->spi_fd < 0)
+         || (ioctl(output->spi_fd, SPI_IOC_WR_MODE, &mode) < 0)
+         || (ioctl(output->spi_fd, SPI_IOC_WR_BITS_PER_WORD, &bits) < 0)
+         || (ioctl(output->spi_fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed) < 0) )
+        {
+            perror( SHIFT_REGISTER_SPI_OPEN_ERROR_MSG );
+            return -1;
+        }
+    }
+    else
+    {
+        if( output->write_pin == NULL )
+            output->write_pin = GpioWrite;
+
+        GpioPinMode( output->data_pin );
+        GpioPinMode( output->clock_pin );
+        GpioPinMode( output->latch_pin );
+        output->write_pin( output->clock_pin, GPIO_LOW );
+        output->write_pin( output->latch_pin, GPIO_LOW );
+    }
+
+    /* Start from a known, dark state */
+    return ShiftRegisterUpdate( output, 0 );
+}
+
+
+/* Shift a frame out, unless the registers already show it */
+int ShiftRegisterUpdate( struct shift_register* output, uint32_t frame )
+{
+    if( (output->frame_valid == true) && (frame == output->frame) )
+        return 0;
+
+    if( output->use_spi == true )
+    {
+        uint8_t bytes[SHIFT_REGISTER_MAX_BITS / 8];
+        size_t  byte_count = output->bits / 8;
+
+        /* Most significant byte first, it has the furthest to travel down the chain */
+        for( size_t index = 0; index < byte_count; index++ )
+            bytes[index] = frame >> (8 * (byte_count - 1 - index));
+
+        if( TEMP_FAILURE_RETRY( write(output->spi_fd, bytes, byte_count) ) != (ssize_t)byte_count )
+        {
+            perror( SHIFT_REGISTER_SPI_WRITE_ERROR_MSG );
+            return -1;
+        }
+    }
+    else
+    {
+        int data = -1;
+
+        for( unsigned int bit = output->bits; bit-- > 0; )
+        {
+            int value = (frame >> bit) & 1;
+
+            if( value != data )
+            {
+                output->write_pin( output->data_pin, value ? GPIO_HIGH : GPIO_LOW );
+                data = value;
+            }
+
+            output->write_pin( output->clock_pin, GPIO_HIGH );
+            output->write_pin( output->clock_pin, GPIO_LOW );
+        }
+
+        output->write_pin( output->latch_pin, GPIO_HIGH );
+        output->write_pin( output->latch_pin, GPIO_LOW );
+    }
+
+    output->frame       = frame;
+    output->frame_valid = true;
+
+    return 0;
+}
+
+
+/* Turn every output off and let go of the SPI device */
+void ShiftRegisterClose( struct shift_register* output )
+{
+    if( (output->use_spi == true) ? (output->spi_fd >= 0) : (output->write_pin != NULL) )
+        ShiftRegisterUpdate( output, 0 );
+
+    if( output->spi_fd >= 0 )
+        close( output->spi_fd );
+
+    output->spi_fd      = -1;
+    output->frame_valid = false;
+}
+
+
+static unsigned int Log2Fixed( unsigned long long value )
+{
+    unsigned int bit_length = 64 - __builtin_clzll( value );
+
+    /* Integer part, then the bits just below the leading one as the fraction */
+    return ((bit_length - 1) << LOG2_FRACTION_BITS)
+         | (unsigned int)(((value << (64 - bit_length)) >> (63 - LOG2_FRACTION_BITS)) & ((1u << LOG2_FRACTION_BITS) - 1));
+}
+
+
+/* Frame with the lowest segments lit, on a log scale: a rate of 1 lights one segment, the full scale rate lights them all,
+ *  and each doubling of the rate in between lights (segments - 1) / log2(full scale) more
+ */
+uint32_t BarGraphFrame( const struct bar_graph* graph, unsigned long long rate )
+{
+    unsigned int lit;
+
+    if( rate == 0 )
+        return 0;
+
+    if( rate >= graph->full_scale )
+    {
+        lit = graph->segments;
+    }
+    else
+    {
+        lit = 1 + (((graph->segments - 1) * Log2Fixed(rate)) / Log2Fixed(graph->full_scale));
+    }
+
+    return (lit >= 32) ? UINT32_MAX : ((UINT32_C(1) << lit) - 1);
+}
@@ -0,0 +1,50 @@
+#ifndef _SHIFT_REGISTER_H
+
+    #define _SHIFT_REGISTER_H
+
+    #include <stdbool.h>
+    #include <stdint.h>
+
+    #define SHIFT_REGISTER_MAX_BITS           32
+    #define SHIFT_REGISTER_MIN_VALID_PIN      0
+    #define SHIFT_REGISTER_MAX_VALID_PIN      29
+    #define SHIFT_REGISTER_SPI_SPEED_HZ       1000000
+    #define SHIFT_REGISTER_SPI_PREFIX         "/dev/"
+
+    #define SHIFT_REGISTER_SPI_OPEN_ERROR_MSG "Could not set up the SPI shift register output"
+    #define SHIFT_REGISTER_SPI_WRITE_ERROR_MSG "Could not write to the SPI shift register output"
+
+    /* Chained 74HC595 (or compatible) shift registers, either bit-banged on three GPIO pins
+     *  (serial data, shift clock, latch/storage clock) or written through spidev, with the
+     *  storage clock on the chip select line. The first bit shifted out ends up on the last
+     *  register of the chain, so bit 0 of a frame is output Q0 of the first register.
+     */
+    struct shift_register
+    {
+        bool         use_spi;
+        char         spi_device[64];
+        int          spi_fd;
+        unsigned int data_pin;
+        unsigned int clock_pin;
+        unsigned int latch_pin;
+        unsigned int bits;                                  /* Multiple of 8, up to SHIFT_REGISTER_MAX_BITS */
+        uint32_t     frame;                                 /* What the outputs show now */
+        bool         frame_valid;
+        void       (*write_pin)( int pin, int value );      /* Pin backend for the bit-banged case */
+    };
+
+    /* A bar graph of a rate, shown on the outputs of a shift register chain */
+    struct bar_graph
+    {
+        struct shift_register output;
+        unsigned int          segments;
+        unsigned long long    full_scale;                   /* Rate that lights every segment */
+    };
+
+    bool     BarGraphParse( const char* spec, struct bar_graph* graph );
+    int      ShiftRegisterOpen( struct shift_register* output );
+    int      ShiftRegisterUpdate( struct shift_register* output, uint32_t frame );
+    void     ShiftRegisterClose( struct shift_register* output );
+    uint32_t BarGraphFrame( const struct bar_graph* graph, unsigned long long rate );
+
+#endif
@@ -0,0 +1,178 @@
+/**************************************************************************
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ **************************************************************************/
+
+/**************************************************************************
+ * Device hot-plug notifications (kernel uevents), shared by PiDiskLeds
+ *  and PiNetLeds. Devices are opened and closed as they come and go, so
+ *  nothing under /sys has to be rescanned while the daemons run.
+ **************************************************************************/
+
+
+/* Using GNU extensions to ISO standards */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <linux/netlink.h>
+
+#include "uevent.h"
+
+
+int UeventOpen( const char* injection_socket_path )
+{
+    int uevent_fd;
+    int receive_buffer_size = UEVENT_RECEIVE_BUFFER_SIZE;
+
+    if( injection_socket_path != NULL )
+    {
+        struct sockaddr_un address;
+
+        if( strlen(injection_socket_path) >= sizeof(address.sun_path) )
+        {
+            errno = ENAMETOOLONG;
+            perror( UEVENT_OPEN_ERROR_MSG );
+            return -1;
+        }
+
+        memset( &address, 0, sizeof(address) );
+        address.sun_family = AF_UNIX;
+        strcpy( address.sun_path, injection_socket_path );
+        unlink( injection_socket_path );
+
+        uevent_fd = socket( AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0 );
+        if( (uevent_fd < 0) || (bind(uevent_fd, (struct sockaddr*)&address, sizeof(address)) != 0) )
+            goto error;
+    }
+    else
+    {
+        struct sockaddr_nl address;
+
+        memset( &address, 0, sizeof(address) );
+        address.nl_family = AF_NETLINK;
+        address.nl_groups = UEVENT_KERNEL_GROUP;
+
+        uevent_fd = socket( AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT );
+        if( (uevent_fd < 0) || (bind(uevent_fd, (struct sockaddr*)&address, sizeof(address)) != 0) )
+            goto error;
+
+        /* A burst of events (a USB hub full of drives) should not overflow the queue; needs privileges, so best effort */
+        if( setsockopt(uevent_fd, SOL_SOCKET, SO_RCVBUFFORCE, &receive_buffer_size, sizeof(receive_buffer_size)) != 0 )
+            setsockopt( uevent_fd, SOL_SOCKET, SO_RCVBUF, &receive_buffer_size, sizeof(receive_buffer_size) );
+    }
+
+    return uevent_fd;
+
+error:
+    perror( UEVENT_OPEN_ERROR_MSG );
+    if( uevent_fd >= 0 )
+        close( uevent_fd );
+
+    return -1;
+}
+
+
+void UeventClose( int uevent_fd, const char* injection_socket_path )
+{
+    if( uevent_fd < 0 )
+        return;
+
+    close( uevent_fd );
+
+    if( injection_socket_path != NULL )
+        unlink( injection_socket_path );
+}
+
+
+/* Value of "KEY=" if the field is that key, NULL otherwise */
+static const char* FieldValue( const char* field, const char* key, size_t key_length )
+{
+    return ((strncmp(field, key, key_length) == 0) && (field[key_length] == '=')) ? (field + key_length + 1) : NULL;
+}
+
+
+int UeventRead( int uevent_fd, char* buffer, size_t buffer_size, struct uevent* event )
+{
+    ssize_t     length;
+    const char* field;
+    const char* value;
+
+    for( ;; )
+    {
+        length = TEMP_FAILURE_RETRY( recv(uevent_fd, buffer, buffer_size - 1, 0) );
+        if( length < 0 )
+        {
+            if( (errno == EAGAIN) || (errno == EWOULDBLOCK) )
+                return 0;
+
+            if( errno != ENOBUFS )
+                perror( UEVENT_READ_ERROR_MSG );
+            return -1;
+        }
+
+        /* Kernel events start with "ACTION@DEVPATH"; anything else (e.g. udev's own broadcasts) is skipped */
+        buffer[length] = '\0';
+        if( (length > 0) && (strchr(buffer, '@') != NULL) )
+            break;
+    }
+
+    memset( event, 0, sizeof(*event) );
+
+    for( field = buffer + strlen(buffer) + 1; field < buffer + length; field += strlen(field) + 1 )
+    {
+        if( (value = FieldValue(field, "ACTION", 6)) != NULL )
+        {
+            event->action = value;
+        }
+        else if( (value = FieldValue(field, "SUBSYSTEM", 9)) != NULL )
+        {
+            event->subsystem = value;
+        }
+        else if( (value = FieldValue(field, "DEVTYPE", 7)) != NULL )
+        {
+            event->devtype = value;
+        }
+        else if( ((value = FieldValue(field, "DEVNAME", 7)) != NULL) || ((value = FieldValue(field, "INTERFACE", 9)) != NULL) )
+        {
+            /* DEVNAME may come as a path below /dev */
+            const char* slash = strrchr( value, '/' );
+
+            event->name = (slash != NULL) ? (slash + 1) : value;
+        }
+        else if( (value = FieldValue(field, "DEVPATH_OLD", 11)) != NULL )
+        {
+            const char* slash = strrchr( value, '/' );
+
+            event->old_name = (slash != NULL) ? (slash + 1) : value;
+        }
+    }
+
+    return 1;
+}
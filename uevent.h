@@ -0,0 +1,45 @@
+#ifndef _UEVENT_H
+
+    #define _UEVENT_H
+
+    #include <stddef.h>
+
+    #define UEVENT_BUFFER_SIZE                8192
+    #define UEVENT_RECEIVE_BUFFER_SIZE        (256 * 1024)
+    #define UEVENT_KERNEL_GROUP               1
+
+    #define UEVENT_ACTION_ADD                 "add"
+    #define UEVENT_ACTION_REMOVE              "remove"
+    #define UEVENT_ACTION_MOVE                "move"
+    #define UEVENT_SUBSYSTEM_BLOCK            "block"
+    #define UEVENT_SUBSYSTEM_NET              "net"
+    #define UEVENT_DEVTYPE_DISK               "disk"
+
+    #define UEVENT_OPEN_ERROR_MSG             "Could not listen for device hot-plug events"
+    #define UEVENT_READ_ERROR_MSG             "Could not read device hot-plug events"
+
+    /* One kernel uevent. The strings point into the buffer given to UeventRead(), and are
+     *  NULL when the event did not carry them. "name" is DEVNAME (block) or INTERFACE (net),
+     *  "old_name" the last part of DEVPATH_OLD for "move" (rename) events.
+     */
+    struct uevent
+    {
+        const char* action;
+        const char* subsystem;
+        const char* devtype;
+        const char* name;
+        const char* old_name;
+    };
+
+    /* Listens to the kernel's NETLINK_KOBJECT_UEVENT broadcasts, or, given a path, to datagrams
+     *  in the same format ("ACTION@DEVPATH\0KEY=VALUE\0...") sent to a Unix socket created at
+     *  that path, so synthetic events can be injected for testing. The socket is nonblocking.
+     */
+    int  UeventOpen( const char* injection_socket_path );
+    void UeventClose( int uevent_fd, const char* injection_socket_path );
+
+    /* 1 with *event filled in, 0 when no event is waiting, -1 on error. errno is ENOBUFS when
+     *  events were lost, in which case the caller should rescan the devices once */
+    int  UeventRead( int uevent_fd, char* buffer, size_t buffer_size, struct uevent* event );
+
+#endif
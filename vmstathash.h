@@ -0,0 +1,45 @@
+#ifndef _VM_STAT_HASH_H
+
+    #define _VM_STAT_HASH_H
+
+    #include <stddef.h>
+    #include <stdint.h>
+
+    /* Hash functions shared by the build-time table generator (mkvmstatkeytable.c) and by
+     *  PiDiskLeds. The generator picks a displacement for every first-level bucket so that
+     *  VmStatHashSlot() sends each known /proc/vmstat key to its own slot (CHD scheme).
+     */
+
+    #define VM_STAT_HASH_OFFSET_BASIS         2166136261u
+    #define VM_STAT_HASH_PRIME                16777619u
+
+    /* FNV-1a over one byte, so the caller can hash a key while scanning for its end */
+    static inline uint32_t VmStatHashStep( uint32_t hash, unsigned char c )
+    {
+        return (hash ^ c) * VM_STAT_HASH_PRIME;
+    }
+
+    static inline uint32_t VmStatHash( const char* key, size_t key_length )
+    {
+        uint32_t hash = VM_STAT_HASH_OFFSET_BASIS;
+
+        while( key_length-- > 0 )
+            hash = VmStatHashStep( hash, (unsigned char)*key++ );
+
+        return hash;
+    }
+
+    /* Second-level slot of a key, given its FNV hash and its bucket's displacement (MurmurHash3 finalizer) */
+    static inline uint32_t VmStatHashSlot( uint32_t hash, uint32_t displacement, uint32_t slot_mask )
+    {
+        hash ^= displacement * 0x9e3779b9u;
+        hash ^= hash >> 16;
+        hash *= 0x85ebca6bu;
+        hash ^= hash >> 13;
+        hash *= 0xc2b2ae35u;
+        hash ^= hash >> 16;
+
+        return hash & slot_mask;
+    }
+
+#endif